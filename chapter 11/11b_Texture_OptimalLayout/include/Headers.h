@@ -42,6 +42,10 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
 #include <iomanip>
 #include <assert.h>
 
@@ -49,6 +53,13 @@
 #include <memory>
 #include <mutex>
 
+// Header files for the worker threads
+#include <thread>
+#include <condition_variable>
+
+// Header file for the render graph pass callbacks
+#include <functional>
+
 /*********** GLM HEADER FILES ***********/
 #define GLM_FORCE_RADIANS
 #include "glm/glm.hpp"
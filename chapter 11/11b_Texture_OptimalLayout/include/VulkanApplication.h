@@ -28,6 +28,7 @@
 #include "VulkanDevice.h"
 #include "VulkanRenderer.h"
 #include "VulkanLED.h"
+#include "VulkanJobSystem.h"
 
 class VulkanApplication
 {
@@ -65,8 +66,10 @@ public:
     VulkanInstance  instanceObj;	// Vulkan Instance object
 	VulkanDevice*   deviceObj;
 	VulkanRenderer* rendererObj;
+	VulkanJobSystem jobSystem;	// Workers shared by the engine subsystems
 	bool isPrepared;
 	bool isResizing;
+	bool isHeadless;	// Render into offscreen images, no window, surface or swapchain
 
 private:
 	bool debugFlag;
@@ -0,0 +1,70 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+
+// Accumulates image and buffer memory barriers and records them with a 
+// single vkCmdPipelineBarrier. The pipeline stages of the flush are the 
+// union of the stages of the accumulated barriers. The transitions can 
+// derive their stage and access masks from the image layouts.
+class VulkanBarrierBuilder
+{
+public:
+	VulkanBarrierBuilder();
+	~VulkanBarrierBuilder();
+
+	// Image layout transition with the stages and accesses derived from the layouts,
+	// shaderStages are the stages accessing the image in the shader readable layouts.
+	void transitionImage(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	// Image barrier with explicit stages and accesses, the queue family 
+	// indices are set for the queue family ownership transfers.
+	void imageBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask,
+		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+
+	// Barrier on the whole buffer with explicit stages and accesses
+	void bufferBarrier(VkBuffer buffer,
+		VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask,
+		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+
+	// Stages and accesses of an image in the layout, as the source or the destination of a transition
+	static void getLayoutStageAccess(VkImageLayout layout, bool isSource, VkPipelineStageFlags shaderStages,
+		VkPipelineStageFlags* stageMask, VkAccessFlags* accessMask);
+
+	// Record the accumulated barriers in the command buffer and start over
+	void flush(VkCommandBuffer cmd);
+
+	inline bool empty() { return bufferBarriers.empty() && imageBarriers.empty(); }
+	inline VkPipelineStageFlags getDstStageMask() { return dstStages; }
+
+private:
+	std::vector<VkBufferMemoryBarrier>	bufferBarriers;
+	std::vector<VkImageMemoryBarrier>	imageBarriers;
+	VkPipelineStageFlags				srcStages;
+	VkPipelineStageFlags				dstStages;
+};
@@ -28,9 +28,14 @@
 #include "Headers.h"
 //#include "VulkanQueue.h"
 #include "VulkanLED.h"
+#include "VulkanMemoryAllocator.h"
 
 class VulkanApplication;
 
+// Host visible device local heaps up to this size are the legacy BAR window
+// of discrete GPUs, bigger ones are unified memory or a resizable BAR.
+#define MAPPABLE_DEVICE_LOCAL_HEAP_MIN_SIZE (256 * 1024 * 1024)
+
 
 // Vulkan exposes one or more devices, each of which exposes one or more queues which may process 
 // work asynchronously to one another.The queues supported by a device are divided into families, 
@@ -54,17 +59,27 @@ public:
 	std::vector<VkQueueFamilyProperties>	queueFamilyProps;				// Store all queue families exposed by the physical device. attributes
 	uint32_t								graphicsQueueIndex;				// Stores graphics queue index
 	uint32_t								graphicsQueueWithPresentIndex;  // Number of queue family exposed by device
+	VkQueue									transferQueue;					// Transfer only queue, VK_NULL_HANDLE if not available
+	uint32_t								transferQueueIndex;				// Transfer only queue family, UINT32_MAX if not available
 	uint32_t								queueFamilyCount;				// Device specificc layer and extensions
 
 	// Layer and extensions
 	VulkanLayerAndExtension		layerExtension;
 	VkPhysicalDeviceFeatures	deviceFeatures;
 
+	// Sub-allocator serving the device memory of all buffers and images
+	VulkanMemoryAllocator*		memoryAllocator;
+
 public:
 	VkResult createDevice(std::vector<const char *>& layers, std::vector<const char *>& extensions);
 	void destroyDevice();
 
 	bool memoryTypeFromProperties(uint32_t typeBits, VkFlags requirements_mask, uint32_t *typeIndex);
+	bool memoryTypeFromProperties(uint32_t typeBits, VkFlags requirements_mask, VkFlags preferred_mask, uint32_t *typeIndex);
+
+	// Check if a resource can live in device local memory the host writes directly,
+	// typeIndex receives the memory type to allocate it from.
+	bool isDeviceLocalMemoryMappable(uint32_t typeBits, uint32_t* typeIndex);
 	
 	// Get the avaialbe queues exposed by the physical devices
 	void getPhysicalDeviceQueuesAndProperties();
@@ -72,6 +87,9 @@ public:
 	// Query physical device to retrive queue properties
 	uint32_t getGraphicsQueueHandle();
 
+	// Check if the device exposes a transfer only queue for the uploads
+	inline bool hasTransferQueue() { return transferQueueIndex != UINT32_MAX; }
+
 	// Queue related member functions.
 	void getDeviceQueue();
 
@@ -28,72 +28,93 @@
 #include "VulkanDescriptor.h"
 #include "Wrappers.h"
 
+// Per instance data of an instanced drawable, 
+// fed to the vertex shader at VERTEX_INPUT_INSTANCE_BINDING.
+struct InstanceData
+{
+	glm::mat4	model;			// Model transformation of the instance
+};
+
+// Vertex input bindings of the drawable
+#define VERTEX_INPUT_VERTEX_BINDING		0
+#define VERTEX_INPUT_INSTANCE_BINDING	1
+
 class VulkanRenderer;
+class VulkanShaderReflection;
 class VulkanDrawable : public VulkanDescriptor
 {
 public:
 	VulkanDrawable(VulkanRenderer* parent = 0);
 	~VulkanDrawable();
 
-	void createVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride, bool useTexture);
-	void prepare();
-	void render();
+	void createVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride);
+
+	// Turns the drawable into an instanced drawable, the geometry is drawn
+	// once per instance in a single draw call. Call after createVertexBuffer().
+	void createInstanceBuffer(const InstanceData* instanceData, uint32_t instanceCount);
 	void update();
 
+	// Record the drawing commands inside the render pass instance begun by the renderer,
+	// the command buffer is either the primary or a secondary command buffer.
+	void recordCommandBuffer(VkCommandBuffer cmdDraw);
+
 	void setPipeline(VkPipeline* vulkanPipeline) { pipeline = vulkanPipeline; }
 	VkPipeline* getPipeline() { return pipeline; }
 
-	void createUniformBuffer();
 	void createDescriptorPool(bool useTexture);
 	void createDescriptorResources();
 	void createDescriptorSet(bool useTexture);
 	void createDescriptorSetLayout(bool useTexture);
 	void createPipelineLayout();
 
+	// Select the attributes of the host layout read by the vertex shader, the
+	// reflected inputs must be described by the host with the same format. 
+	// Call once the vertex and instance buffers are created.
+	void createVertexInput(const std::vector<VkVertexInputAttributeDescription>& hostAttributes, const VulkanShaderReflection& reflection);
+
 	void initViewports(VkCommandBuffer* cmd);
 	void initScissors(VkCommandBuffer* cmd);
 
 	void destroyVertexBuffer();
-	void destroyCommandBuffer();
-	void destroySynchronizationObjects();
-	void destroyUniformBuffer();
+	void destroyInstanceBuffer();
 
+	// Set the texture sampled by the drawable, the descriptor set of each 
+	// frame slot is refreshed by updateDescriptorSet() once the slot is free.
 	void setTextures(TextureData* tex);
+	void updateDescriptorSet(uint32_t frameIndex);
 public:
-	struct {
-		VkBuffer						buffer;			// Buffer resource object
-		VkDeviceMemory					memory;			// Buffer resourece object's allocated device memory
-		VkDescriptorBufferInfo			bufferInfo;		// Buffer info that need to supplied into write descriptor set (VkWriteDescriptorSet)
-		VkMemoryRequirements			memRqrmnt;		// Store the queried memory requirement of the uniform buffer
-		std::vector<VkMappedMemoryRange>mappedRange;	// Metadata of memory mapped objects
-		uint8_t*						pData;			// Host pointer containing the mapped device address which is used to write data into.
-	} UniformData;
-
 	// Structure storing vertex buffer metadata
 	struct {
 		VkBuffer buf;
-		VkDeviceMemory mem;
+		MemoryAllocation mem;
 		VkDescriptorBufferInfo bufferInfo;
 	} VertexBuffer;
 
-	// Stores the vertex input rate
-	VkVertexInputBindingDescription		viIpBind;
-	// Store metadata helpful in data interpretation
-	VkVertexInputAttributeDescription	viIpAttrb[2];
+	// Structure storing per instance buffer metadata
+	struct {
+		VkBuffer buf;
+		MemoryAllocation mem;
+		uint32_t count;			// Number of instances, 0 if the drawable is not instanced
+	} InstanceBuffer;
+
+	// Stores the vertex input rate of the vertex and instance bindings
+	VkVertexInputBindingDescription		viIpBind[2];
+	uint32_t							viIpBindCount;
+	// Store metadata helpful in data interpretation, reflected from the vertex shader
+	VkVertexInputAttributeDescription	viIpAttrb[6];
+	uint32_t							viIpAttrbCount;
 
 private:
-	std::vector<VkCommandBuffer> vecCmdDraw;			// Command buffer for drawing
-	void recordCommandBuffer(int currentImage, VkCommandBuffer* cmdDraw);
 	VkViewport viewport;
 	VkRect2D   scissor;
-	VkSemaphore presentCompleteSemaphore;
-	VkSemaphore drawingCompleteSemaphore;
 	TextureData* textures;
+	uint32_t	 dirtyDescriptorSets;	// Bit mask of the frame slots whose texture descriptor is outdated
 
 	glm::mat4 Projection;
 	glm::mat4 View;
 	glm::mat4 Model;
 	glm::mat4 MVP;
+	float	  rotation;
 
 	VulkanRenderer* rendererObj;
 	VkPipeline*		pipeline;
@@ -0,0 +1,104 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include <atomic>
+
+// Number of worker threads, 0 uses one worker per hardware thread minus the calling thread
+#define JOB_SYSTEM_WORKER_COUNT 0
+
+// A unit of work, it is finished once its function and all its children are
+struct Job {
+	std::function<void()>	function;
+	std::shared_ptr<Job>	parent;
+	std::atomic<int32_t>	unfinished;		// The job itself plus its unfinished children
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+// Work stealing job system shared by the engine subsystems. Each worker owns
+// a deque of jobs, it pops the jobs it pushed from the back and steals from 
+// the front of the other deques when its own is empty. The threads which are
+// not workers push their jobs in an extra shared deque. A job may be created
+// as the child of another job, waiting for the parent waits for the children.
+// The waiting thread executes the pending jobs instead of blocking. The long
+// running jobs go to a background deque only the workers pick from, a thread
+// waiting for short jobs never gets stuck in one of them.
+class VulkanJobSystem
+{
+public:
+	VulkanJobSystem();
+	~VulkanJobSystem();
+
+	// Start the worker threads, does nothing if already started
+	void create(uint32_t workerCount = JOB_SYSTEM_WORKER_COUNT);
+
+	// Execute the pending jobs and stop the workers
+	void destroy();
+
+	// Create a job without running it, the children may then be added before it runs
+	JobHandle createJob(std::function<void()> function, const JobHandle& parent = JobHandle());
+
+	// Queue a created job for execution
+	void run(const JobHandle& job);
+
+	// Create and queue the job
+	JobHandle schedule(std::function<void()> function, const JobHandle& parent = JobHandle());
+
+	// Queue a long running job (file I/O, decoding), it is only executed by the workers
+	JobHandle scheduleBackground(std::function<void()> function);
+
+	// Wait until the job and its children are finished, executing pending jobs meanwhile
+	void wait(const JobHandle& job);
+
+	inline bool isFinished(const JobHandle& job) { return job->unfinished.load() == 0; }
+
+	// Run function(i) for i in [0, count) over the workers and wait for completion
+	void parallelFor(uint32_t count, std::function<void(uint32_t)> function);
+
+	inline uint32_t getWorkerCount() { return (uint32_t)workers.size(); }
+
+private:
+	// Deque of a worker, followed by the one shared by the other threads and the background one
+	struct JobQueue {
+		std::mutex				mutex;
+		std::deque<JobHandle>	jobs;
+	};
+
+	void workerMain(uint32_t workerIndex);
+	void push(JobQueue* queue, const JobHandle& job);
+	bool executeNext(bool background);	// Execute one pending job, returns false if none was found
+	void finish(const JobHandle& job);
+	uint32_t getQueueIndex();			// Deque of the calling thread
+
+	std::vector<std::thread>	workers;
+	std::vector<JobQueue*>		queues;
+	JobQueue*					backgroundQueue;
+	std::mutex					sleepMutex;		// Guards the idle workers wake up
+	std::condition_variable		wakeUp;
+	std::atomic<uint32_t>		pendingJobs;	// Jobs queued and not yet started
+	bool						quit;
+};
@@ -0,0 +1,105 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Size of the device memory blocks requested from the driver, every
+// buffer and image is carved out of these blocks. Resources larger 
+// than half of a block receive a dedicated device memory allocation.
+#define MEMORY_BLOCK_SIZE (64 * 1024 * 1024)
+
+// Attachments with these usages only never leave the render pass, they are created 
+// with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and may live in tile memory only.
+#define TRANSIENT_ATTACHMENT_USAGE_MASK	(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | \
+										VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)
+
+struct MemoryBlock;
+
+// A sub-range of a device memory block handed out by the allocator
+struct MemoryAllocation {
+	VkDeviceMemory	memory;				// Device memory block containing the range
+	VkDeviceSize	offset;				// Offset of the range in the memory block
+	VkDeviceSize	size;				// Size of the range
+	uint32_t		memoryTypeIndex;	// Memory type of the memory block
+	uint8_t*		pMapped;			// Host address of the range, NULL if not host visible
+	MemoryBlock*	block;				// Owner block, used while releasing the range
+};
+
+// Device memory object allocated with vkAllocateMemory(), its free 
+// space is maintained as a list of ranges sorted by their offset.
+struct MemoryBlock {
+	VkDeviceMemory							memory;				// Device memory object
+	VkDeviceSize							size;				// Total size of the block
+	uint32_t								memoryTypeIndex;	// Memory type of the block
+	bool									linear;				// Holds buffers and linear images only
+	bool									dedicated;			// Block holds a single resource
+	uint8_t*								pMapped;			// Persistent host mapping of host visible blocks
+	uint32_t								allocationCount;	// Number of live ranges in the block
+	std::map<VkDeviceSize, VkDeviceSize>	freeRanges;			// Free ranges, offset to size
+};
+
+// The allocator reduces the number of vkAllocateMemory() calls by sub-allocating 
+// buffers and images from large device memory blocks. Linear resources (buffers
+// and linear images) and non-linear (optimal tiled) images are never placed in 
+// the same block, this way bufferImageGranularity never needs to be considered 
+// between neighbouring ranges.
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator(VulkanDevice* device);
+	~VulkanMemoryAllocator();
+
+	// Allocate memory for the given requirements. The requirementsMask properties are mandatory 
+	// while preferredMask properties are used when a compatible memory type offers them.
+	bool allocate(const VkMemoryRequirements& memRqrmnt, VkFlags requirementsMask, VkFlags preferredMask, bool linear, MemoryAllocation* allocation);
+	void free(MemoryAllocation* allocation);
+
+	// Query the resource requirements, allocate and bind the memory in one go.
+	// The memory types of the buffer can be restricted further with memoryTypeBits.
+	bool allocateBufferMemory(VkBuffer buffer, VkFlags requirementsMask, VkFlags preferredMask, MemoryAllocation* allocation, uint32_t memoryTypeBits = UINT32_MAX);
+	bool allocateImageMemory(VkImage image, VkFlags requirementsMask, VkFlags preferredMask, bool linearTiling, MemoryAllocation* allocation);
+
+	// Memory of transient attachments, lazily allocated when the device offers 
+	// it and device local otherwise. Lazily allocated memory is committed by 
+	// the driver only if the attachment content leaves the tile memory.
+	bool allocateTransient(const VkMemoryRequirements& memRqrmnt, MemoryAllocation* allocation);
+	bool allocateTransientImageMemory(VkImage image, MemoryAllocation* allocation);
+
+	// Release all the device memory blocks, must be called before the device is destroyed
+	void destroy();
+
+private:
+	MemoryBlock* createBlock(VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, bool dedicated);
+	bool allocateFromBlock(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation* allocation);
+	void destroyBlock(MemoryBlock* block);
+
+	VulkanDevice*				deviceObj;
+	std::vector<MemoryBlock*>	blocks;		// All device memory blocks
+	std::mutex					mutex;		// Guards the blocks and their free ranges
+};
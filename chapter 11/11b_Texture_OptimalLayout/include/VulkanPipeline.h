@@ -25,6 +25,7 @@
 
 #pragma once
 #include "Headers.h"
+#include "VulkanJobSystem.h"
 class VulkanShader;
 class VulkanDrawable;
 class VulkanDevice;
@@ -35,6 +36,38 @@ class VulkanApplication;
 #define NUMBER_OF_VIEWPORTS 1
 #define NUMBER_OF_SCISSORS NUMBER_OF_VIEWPORTS
 
+// File storing the pipeline cache contents between the application runs
+#define PIPELINE_CACHE_FILE_NAME "pipeline_cache.bin"
+
+// Description of a pipeline compiled by VulkanPipeline::createPipelines()
+struct PipelineDescription {
+	VulkanDrawable*	drawableObj;
+	VulkanShader*	shaderObj;
+	VkBool32		includeDepth;
+	VkBool32		includeVi;
+	VkPipeline		pipeline;		// Result, VK_NULL_HANDLE if the creation failed
+};
+
+// Identity of a pipeline, the packed bytes of every state which differs 
+// between the pipelines built by createPipeline(): shader stages and their
+// specialization constants, layout, render pass, vertex input and the 
+// depth/vertex input switches.
+struct PipelineKey {
+	std::vector<uint8_t>	data;
+	size_t					hash;
+
+	PipelineKey() : hash(0) {}
+
+	// Append the bytes of a state to the key
+	void add(const void* bytes, size_t size);
+
+	inline bool operator==(const PipelineKey& other) const { return hash == other.hash && data == other.data; }
+};
+
+struct PipelineKeyHasher {
+	inline size_t operator()(const PipelineKey& key) const { return key.hash; }
+};
+
 class VulkanPipeline
 {
 public:
@@ -42,7 +75,9 @@ public:
 
 	~VulkanPipeline();
 	
-	// Creates the pipeline cache object and stores pipeline object
+	// Creates the pipeline cache object and stores pipeline object, the cache
+	// is seeded with the data saved on disk by the previous run if it matches
+	// the physical device. The existing cache is kept on re-creation (resize).
 	void createPipelineCache();
 	
 	// Returns the created pipeline object, it takes the drawable object which 
@@ -51,13 +86,67 @@ public:
 	// if the vertex input are available. 	
 	bool createPipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi = true);
 
-	// Destruct the pipeline cache object
+	// Compile a batch of pipelines concurrently on the job system workers. The
+	// returned job finishes once every description holds its pipeline, the 
+	// descriptions must stay alive until then. Identical descriptions share
+	// one reference counted pipeline, only the distinct states are compiled.
+	// The jobs compile a snapshot of the shader stages and specialization 
+	// constants taken here, the shaders may be changed while they run.
+	JobHandle createPipelines(std::vector<PipelineDescription>& descriptions);
+
+	// Drop a reference on a pipeline returned by createPipelines(), 
+	// it is destroyed with its last reference
+	void releasePipeline(VkPipeline pipeline);
+
+	// Return the descriptor set layout of the bindings, the shaders with the same bindings share it
+	VkDescriptorSetLayout acquireDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& layoutBindings);
+	void releaseDescriptorSetLayout(VkDescriptorSetLayout layout);
+
+	// Return the pipeline layout of the set layouts and push constant ranges, shared likewise
+	VkPipelineLayout acquirePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	void releasePipelineLayout(VkPipelineLayout layout);
+
+	// Serialize the pipeline cache contents to disk
+	void savePipelineCache();
+
+	// Save and destruct the pipeline cache object
 	void destroyPipelineCache();
 
+private:
+	// Check the pipeline cache header belongs to the current physical device
+	bool isPipelineCacheDataValid(const void* data, size_t size);
+
+	// Build the key of the state createPipeline() would produce
+	PipelineKey getPipelineKey(const PipelineDescription& description);
+
+	// Create the pipeline from the given shader stages
+	bool createPipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, const VkPipelineShaderStageCreateInfo* shaderStages, VkBool32 includeDepth, VkBool32 includeVi);
+
+	// Pipeline shared by all the identical descriptions
+	struct SharedPipeline {
+		VkPipeline	pipeline;
+		uint32_t	refCount;
+	};
+
+	struct SharedDescriptorSetLayout {
+		VkDescriptorSetLayout	layout;
+		uint32_t				refCount;
+	};
+
+	struct SharedPipelineLayout {
+		VkPipelineLayout	layout;
+		uint32_t			refCount;
+	};
+
 public:
 	// Pipeline preparation member variables
 	// Pipeline cache object
 	VkPipelineCache						pipelineCache;
+	std::unordered_map<PipelineKey, SharedPipeline, PipelineKeyHasher> pipelines;
+	std::unordered_map<VkPipeline, PipelineKey> pipelineKeys;		// Key of each shared pipeline, for the releases
+	std::unordered_map<PipelineKey, SharedDescriptorSetLayout, PipelineKeyHasher> descriptorSetLayouts;
+	std::unordered_map<PipelineKey, SharedPipelineLayout, PipelineKeyHasher> pipelineLayouts;
+	std::mutex							pipelinesMutex;		// Guards the maps, the jobs fill the pipeline entries
 	VulkanApplication*					appObj;
 	VulkanDevice*						deviceObj;
 };
\ No newline at end of file
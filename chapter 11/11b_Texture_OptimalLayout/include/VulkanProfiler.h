@@ -0,0 +1,136 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Maximum number of timestamp queries written per frame, two per scope
+#define PROFILER_MAX_QUERIES	256
+
+// Number of samples of each scope kept for the rolling statistics
+#define PROFILER_HISTORY_SIZE	240
+
+// Default export files of the profiler statistics
+#define PROFILER_JSON_FILE_NAME	"gpu_profile.json"
+#define PROFILER_CSV_FILE_NAME	"gpu_profile.csv"
+
+// Returned by beginScope() when the queue does not support timestamps
+#define PROFILER_INVALID_SCOPE	UINT32_MAX
+
+// The GPU profiler measures the execution time of the command ranges 
+// enclosed between beginScope() and endScope() using timestamp queries.
+// Each frame in flight owns a query pool, the results of a frame are read 
+// back when its slot is reused, which is once the frame fence is signaled,
+// so the readback never stalls. Scopes recorded before the first frame 
+// go in a separate setup pool which is read back as soon as all of its 
+// results are available. The staging uploads are submitted outside of the
+// frames and use their own upload pool, polled likewise and recycled once 
+// read back, so a frame slot never waits for an upload.
+class VulkanProfiler
+{
+public:
+	VulkanProfiler();
+	~VulkanProfiler();
+
+	// Create the query pools, does nothing if already created
+	void create(uint32_t frameCount);
+	void destroy();
+
+	// Collect the results of the previous use of the frame slot and reset its
+	// queries, must be recorded outside of a render pass instance, before any
+	// scope of the frame. The fence of the frame slot must be signaled.
+	void beginFrame(uint32_t frameIndex, VkCommandBuffer cmd);
+
+	// Write the timestamps enclosing a scope, the returned scope is passed to
+	// endScope(). Scopes can be recorded in any command buffer submitted to the
+	// graphics queue, including secondary command buffers, from any thread.
+	uint32_t beginScope(VkCommandBuffer cmd, const char* name);
+	void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+	// Write the timestamps of a scope recorded in a staging command buffer into the 
+	// upload pool, the scope ends with endScope(). Must be recorded outside of a
+	// render pass instance, the pool is reset in the command buffer if needed.
+	uint32_t beginUploadScope(VkCommandBuffer cmd, const char* name);
+
+	// Read back all the pending results, the device must be idle
+	void flush();
+
+	// Export the rolling statistics of each scope in milliseconds
+	bool exportJSON(const char* fileName = PROFILER_JSON_FILE_NAME);
+	bool exportCSV(const char* fileName = PROFILER_CSV_FILE_NAME);
+
+private:
+	// Query pool and the scopes written into it
+	struct QuerySlot {
+		VkQueryPool					pool;
+		uint32_t					queryCount;		// Number of queries written since the reset
+		std::vector<std::string>	names;			// Scope names, scope i uses the queries 2i and 2i+1
+		bool						reset;			// Queries are reset and can be written
+		bool						pending;		// Results are waiting to be read back
+	};
+
+	// Rolling statistics of a scope
+	struct ScopeStats {
+		std::vector<double>	samples;		// Last PROFILER_HISTORY_SIZE durations in milliseconds
+		uint32_t			next;			// Ring position of the next sample
+		uint64_t			count;			// Total number of samples
+	};
+
+	void createSlot(QuerySlot* slot);
+	void destroySlot(QuerySlot* slot);
+	uint32_t beginScope(QuerySlot* slot, VkCommandBuffer cmd, const char* name);
+	QuerySlot* getSlot(uint32_t slotIndex);
+	bool readback(QuerySlot* slot, bool wait);
+	void pollUploadSlot(bool wait);
+	void addSample(const std::string& name, double milliseconds);
+	void computeStats(const ScopeStats& stats, double* average, double* minimum, double* maximum, double* last);
+
+	VulkanDevice*						deviceObj;
+	bool								supported;		// Graphics queue supports timestamps
+	uint64_t							timestampMask;	// Valid bits of the timestamps
+	double								nanosecondsPerTick;
+	std::vector<QuerySlot>				frameSlots;		// One slot per frame in flight
+	QuerySlot							setupSlot;		// Scopes recorded before the first frame
+	QuerySlot							uploadSlot;		// Scopes of the staging command buffers
+	QuerySlot*							currentSlot;	// Slot receiving the scopes
+	std::mutex							mutex;			// Guards the query allocation
+	std::map<std::string, ScopeStats>	stats;
+};
+
+// Helper measuring the commands recorded during its lifetime
+class VulkanProfileScope
+{
+public:
+	VulkanProfileScope(VulkanProfiler* profiler, VkCommandBuffer cmd, const char* name)
+		: profiler(profiler), cmd(cmd) { scope = profiler->beginScope(cmd, name); }
+	~VulkanProfileScope() { profiler->endScope(cmd, scope); }
+
+private:
+	VulkanProfiler*	profiler;
+	VkCommandBuffer	cmd;
+	uint32_t		scope;
+};
@@ -0,0 +1,140 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanBarrierBuilder.h"
+
+class VulkanDevice;
+class VulkanResourceTracker;
+
+#define RENDER_GRAPH_INVALID_INDEX UINT32_MAX
+
+// The render graph describes the frame as a list of passes declaring the 
+// images they read and write. Once compiled, the passes are ordered after 
+// their producers, the passes contributing to no output are culled and the
+// transient images whose lifetimes don't overlap share the same memory. 
+// While executing, the layout transitions and the memory dependencies 
+// between the passes are derived from the resource tracker state.
+class VulkanRenderGraph
+{
+public:
+	// Records the commands of a pass in the frame command buffer
+	typedef std::function<void(VkCommandBuffer)> RecordFunction;
+
+	VulkanRenderGraph();
+	~VulkanRenderGraph();
+
+	// Start declaring a new graph, the previous one is destroyed
+	void begin(VulkanResourceTracker* tracker);
+
+	// Image owned outside the graph, its handles are set with setImportedImage()
+	uint32_t importImage(const char* name, VkImageAspectFlags aspectMask);
+	void setImportedImage(uint32_t resource, VkImage image, VkImageView view);
+
+	// Image owned by the graph, its memory may alias other transient images. Images used 
+	// as attachments only never leave the render passes and are created transient.
+	uint32_t createTransientImage(const char* name, VkFormat format, uint32_t width, uint32_t height,
+		VkImageUsageFlags usage, VkImageAspectFlags aspectMask);
+
+	uint32_t addPass(const char* name, RecordFunction record);
+
+	// Declare the use of an image by a pass. The image is transitioned to the layout 
+	// before the pass, and is left in finalLayout by the pass. The layout of an imported
+	// image may be VK_IMAGE_LAYOUT_UNDEFINED when the pass discards its content.
+	void readImage(uint32_t pass, uint32_t resource, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask,
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+	void writeImage(uint32_t pass, uint32_t resource, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask,
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	// The resource is consumed outside of the graph, its producers are never culled
+	void markOutput(uint32_t resource);
+
+	// Order and cull the passes, create the transient images and their aliased memory
+	void compile();
+
+	// Record the passes with their barriers in the command buffer
+	void execute(VkCommandBuffer cmd);
+
+	void destroy();
+
+	inline VkImage getImage(uint32_t resource)		{ return resources[resource].image; }
+	inline VkImageView getImageView(uint32_t resource)	{ return resources[resource].view; }
+
+private:
+	struct Resource {
+		std::string				name;
+		bool					transient;
+		bool					output;
+		VkImage					image;
+		VkImageView				view;
+		VkImageAspectFlags		aspectMask;
+		VkImageCreateInfo		imageInfo;		// Transient images only
+		uint32_t				firstPass;		// Lifetime in the execution order, transient images only
+		uint32_t				lastPass;
+		uint32_t				memoryIndex;	// Aliased memory of the transient image
+	};
+
+	struct ResourceUse {
+		uint32_t				resource;
+		bool					write;
+		VkImageLayout			layout;
+		VkImageLayout			finalLayout;
+		VkPipelineStageFlags	stageMask;
+		VkAccessFlags			accessMask;
+	};
+
+	struct Pass {
+		std::string					name;
+		RecordFunction				record;
+		std::vector<ResourceUse>	uses;
+		bool						culled;
+	};
+
+	// Memory shared by the transient images of non overlapping lifetimes
+	struct AliasedMemory {
+		MemoryAllocation		allocation;
+		VkMemoryRequirements	requirements;
+		std::vector<uint32_t>	resources;
+		bool					transient;		// Holds transient attachments, may be lazily allocated
+		VkPipelineStageFlags	lastStageMask;	// Last use of the memory by any of its images
+		VkAccessFlags			lastAccessMask;
+	};
+
+	void addUse(uint32_t pass, uint32_t resource, bool write, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkImageLayout finalLayout);
+	void sortPasses();
+	void cullPasses();
+	void createTransientImages();
+
+	VulkanDevice*					deviceObj;
+	VulkanResourceTracker*			tracker;
+	std::vector<Resource>			resources;
+	std::vector<Pass>				passes;
+	std::vector<uint32_t>			executionOrder;		// Indices of the passes which are not culled
+	std::vector<AliasedMemory>		memories;
+	std::vector<VkImage>			registeredImages;	// Imported images registered in the tracker by the graph
+	bool							compiled;
+};
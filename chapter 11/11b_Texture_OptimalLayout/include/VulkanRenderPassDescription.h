@@ -0,0 +1,60 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+
+// Describes a single subpass render pass: the attachments with the intent 
+// on their content, and the explicit dependencies with the commands before 
+// and after the render pass. The attachment content is neither loaded nor
+// stored unless asked, the stencil aspect is ignored unless asked.
+class VulkanRenderPassDescription
+{
+public:
+	VulkanRenderPassDescription();
+	~VulkanRenderPassDescription();
+
+	// Color attachment of the subpass, cleared or loaded, stored or discarded at the end
+	uint32_t addColorAttachment(VkFormat format, VkSampleCountFlagBits samples, VkAttachmentLoadOp loadOp,
+		VkAttachmentStoreOp storeOp, VkImageLayout finalLayout);
+
+	// Depth stencil attachment of the subpass, the depth content is discarded by default
+	uint32_t addDepthStencilAttachment(VkFormat format, VkSampleCountFlagBits samples, VkAttachmentLoadOp loadOp,
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VkAttachmentLoadOp stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE, VkAttachmentStoreOp stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE);
+
+	// Execution and memory dependency, VK_SUBPASS_EXTERNAL for the commands outside the render pass
+	void addDependency(uint32_t srcSubpass, uint32_t dstSubpass, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask,
+		VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+
+	VkRenderPass create(VkDevice device);
+
+private:
+	std::vector<VkAttachmentDescription>	attachments;
+	std::vector<VkAttachmentReference>		colorReferences;
+	VkAttachmentReference					depthReference;
+	bool									hasDepth;
+	std::vector<VkSubpassDependency>		dependencies;
+};
@@ -29,11 +29,44 @@
 #include "VulkanDrawable.h"
 #include "VulkanShader.h"
 #include "VulkanPipeline.h"
+#include "VulkanStagingRing.h"
+#include "VulkanBarrierBuilder.h"
+#include "VulkanResourceTracker.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanRenderPassDescription.h"
+#include "VulkanProfiler.h"
+#include "VulkanUniformRing.h"
+#include "VulkanTextureLoader.h"
 
 // Number of samples needs to be the same at image creation
 // Used at renderpass creation (in attachment) and pipeline creation
 #define NUM_SAMPLES VK_SAMPLE_COUNT_1_BIT
 
+// Number of frames the CPU may record and submit ahead of the GPU.
+// Each frame in flight owns its command buffer, fence and semaphores,
+// setting this to 1 falls back to fully serialized CPU/GPU execution.
+#define MAX_FRAMES_IN_FLIGHT 2
+
+// Number of worker threads recording the drawables into secondary command buffers,
+// the drawables are evenly partitioned across the workers. Setting this to 0 
+// records all the drawables inline in the primary command buffer.
+#define RECORDING_THREAD_COUNT 4
+
+// Number of cube instances drawn by the instanced drawable in a single
+// draw call, laid out on a 3D grid. Setting this to 0 draws a single
+// non instanced cube. The instanced path uses the TextureInstanced.vert 
+// shader, which is only shipped as GLSL: it requires the runtime
+// compilation enabled by BUILD_SPV_ON_COMPILE_TIME.
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+#define INSTANCE_COUNT 27
+#else
+#define INSTANCE_COUNT 0
+#endif
+
+#if INSTANCE_COUNT > 0 && !defined(AUTO_COMPILE_GLSL_TO_SPV)
+#error "INSTANCE_COUNT > 0 requires BUILD_SPV_ON_COMPILE_TIME, TextureInstanced-vert.spv is not provided"
+#endif
+
 // The Vulkan Renderer is custom class, it is not a Vulkan specific class.
 // It works as a presentation manager.
 // It manages the presentation windows and drawing surfaces.
@@ -50,6 +83,15 @@ public:
 	void update();
 	bool render();
 
+	// Acquire the next image, record the drawables into it, submit and present
+	void renderFrame();
+
+	// Recreate the swapchain, depth image and framebuffers with the new extent
+	void resize();
+
+	// Declare the passes of the frame and their images, rebuilt on resize
+	void buildRenderGraph();
+
 	// Create an empty window
 	void createPresentationWindow(const int& windowWidth = 500, const int& windowHeight = 500);
 	void setImageLayout(VkImage image, VkImageAspectFlags aspectMask, VkImageLayout oldImageLayout, VkImageLayout newImageLayout, const VkImageSubresourceRange& subresourceRange, const VkCommandBuffer& cmdBuf);
@@ -68,11 +110,29 @@ public:
 	inline VkCommandPool* getCommandPool()			{ return &cmdPool; }
 	inline VulkanShader*  getShader()				{ return &shaderObj; }
 	inline VulkanPipeline*	getPipelineObject()		{ return &pipelineObj; }
+	inline VulkanStagingRing*	getStagingRing()	{ return &stagingRing; }
+	inline VulkanProfiler*	getProfiler()			{ return &profiler; }
+	inline VulkanUniformRing*	getUniformRing()	{ return &uniformRing; }
+	inline VulkanResourceTracker*	getResourceTracker()	{ return &resourceTracker; }
+	inline VulkanRenderGraph*	getRenderGraph()	{ return &renderGraph; }
+	inline uint32_t			getCurrentFrame()		{ return currentFrame; }
 
 	void createCommandPool();							// Create command pool
+
+	// The one-shot initialization commands are recorded in a single command 
+	// buffer, the staged uploads are held back in the staging ring. Both are
+	// submitted by endInitBatch() which waits once for the whole batch.
+	void beginInitBatch();
+	void endInitBatch();
+
 	void buildSwapChainAndDepthImage();					// Create swapchain color image and depth image
 	void createDepthImage();							// Create depth image
 	void createVertexBuffer();
+
+	// Create a buffer in device local memory filled with the data. The data is 
+	// copied through the staging ring unless the device local memory is host 
+	// visible, the upload is submitted with the next staging ring submission.
+	void createDeviceLocalBuffer(VkBufferUsageFlags usage, const void* data, VkDeviceSize size, VkBuffer* buffer, MemoryAllocation* mem);
 	void createRenderPass(bool includeDepth, bool clear = true);	// Render Pass creation
 	void createFrameBuffer(bool includeDepth);
 	void createShaders();
@@ -80,18 +140,28 @@ public:
 	void createDescriptors();
 	void createTextureLinear (const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
 	void createTextureOptimal(const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+	void createTextureOptimal(const gli::texture2D& image2D, TextureData *texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+	void createPlaceholderTexture(TextureData *texture);
+
+	// Upload the textures decoded by the texture loader and swap them in the drawables
+	void streamTextures();
 
 	void destroyCommandBuffer();
 	void destroyCommandPool();
 	void destroyDepthBuffer();
 	void destroyDrawableVertexBuffer();
+	void destroyRenderGraph();
 	void destroyRenderpass();										// Destroy the render pass object when no more required
 	void destroyFramebuffers();
 	void destroyPipeline();
-	void destroyDrawableCommandBuffer();
-	void destroyDrawableSynchronizationObjects();
-	void destroyDrawableUniformBuffer();
+	void destroyFrameCommandBuffers();
+	void destroyFrameSynchronizationObjects();
+	void destroyRecordingThreads();
+	void destroyUniformRing();
 	void destroyTextureResource();
+	void destroyTextureLoader();
+	void destroyStagingRing();
+	void destroyProfiler();
 public:
 #ifdef _WIN32
 #define APP_NAME_STR_LEN 80
@@ -108,14 +178,15 @@ public:
 	struct{
 		VkFormat		format;
 		VkImage			image;
-		VkDeviceMemory	mem;
+		MemoryAllocation	mem;
 		VkImageView		view;
 	}Depth;
 
-	VkCommandBuffer		cmdDepthImage;			// Command buffer for depth image layout
 	VkCommandPool		cmdPool;				// Command pool
-	VkCommandBuffer		cmdVertexBuffer;		// Command buffer for vertex buffer - Triangle geometry
-	VkCommandBuffer		cmdTexture;				// Command buffer for creating the texture
+	VkCommandBuffer		cmdInit;				// Command buffer of the init batch - depth and linear texture layouts
+	bool				initBatchRecording;		// Between beginInitBatch() and endInitBatch()
+	VulkanBarrierBuilder	initBarriers;		// Layout transitions of the init batch, flushed at once
+	VulkanResourceTracker	resourceTracker;	// Layout and access state of the images
 
 	VkRenderPass		renderPass;				// Render pass created object
 	std::vector<VkFramebuffer> framebuffers;	// Number of frame buffer corresponding to each swap chain
@@ -123,8 +194,44 @@ public:
 
 	int					width, height;
 	TextureData			texture;
+	TextureData			placeholderTexture;		// Sampled until the texture is resident
 
 private:
+	void recordCommandBuffer(uint32_t currentImage, VkCommandBuffer cmdDraw);
+
+	// Multithreaded recording of the drawables in secondary command buffers
+	void createRecordingThreads();
+	void recordingThreadMain(uint32_t threadIndex);
+	void recordSecondaryCommandBuffer(uint32_t threadIndex);
+
+	// Per frame resources, a frame slot is reused only after 
+	// its fence is signaled by the GPU.
+	struct FrameData {
+		VkCommandBuffer	cmdDraw;					// Primary command buffer for drawing
+		VkFence			fence;						// Signaled when the GPU finished the frame
+		VkSemaphore		presentCompleteSemaphore;	// Signaled when the swapchain image is acquired
+		VkSemaphore		drawingCompleteSemaphore;	// Signaled when the rendering is finished
+	};
+	std::vector<FrameData>	frames;					// Frames in flight
+	uint32_t				currentFrame;			// Index of the frame slot being recorded
+
+	// A recording worker owns a command pool per frame slot, so that the pool
+	// can be reset as a whole once the fence of the frame is signaled.
+	struct RecordingThread {
+		std::thread		thread;
+		VkCommandPool	cmdPools[MAX_FRAMES_IN_FLIGHT];
+		VkCommandBuffer	cmdBufs[MAX_FRAMES_IN_FLIGHT];	// Secondary command buffer of each frame slot
+		bool			hasCommands;					// Worker recorded drawables for the current frame
+	};
+	std::vector<RecordingThread*>	recordingThreads;
+	std::mutex						recordMutex;		// Guards the members below
+	std::condition_variable			recordStart;		// Signals the workers to record a frame
+	std::condition_variable			recordDone;			// Signals the render thread the workers are done
+	uint64_t						recordGeneration;	// Incremented for each frame to record
+	uint32_t						pendingRecorders;	// Number of workers still recording
+	uint32_t						recordImage;		// Framebuffer index of the frame to record
+	bool							recordQuit;			// Asks the workers to exit
+
 	VulkanApplication* application;
 	// The device object associated with this Presentation layer.
 	VulkanDevice*	   deviceObj;
@@ -132,4 +239,11 @@ private:
 	std::vector<VulkanDrawable*> drawableList;
 	VulkanShader 	   shaderObj;
 	VulkanPipeline 	   pipelineObj;
+	VulkanStagingRing  stagingRing;
+	VulkanProfiler	   profiler;
+	VulkanUniformRing  uniformRing;
+	VulkanTextureLoader textureLoader;
+	VulkanRenderGraph  renderGraph;
+	uint32_t		   backbufferResource;	// Render graph resources
+	uint32_t		   depthResource;
 };
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include "VulkanBarrierBuilder.h"
+
+// Tracks the layout and the accesses since the last barrier of each mip 
+// level and array layer of the registered images. When an image range is
+// used, only the subresources whose state differs get a transition, and 
+// read after read in the same layout gets none. The tracker is used by the 
+// thread recording the setup and upload commands. The queue family ownership
+// transfers are recorded by the staging ring, which completes them before 
+// the resources are used, the tracked images are always owned by the 
+// graphics queue family.
+class VulkanResourceTracker
+{
+public:
+	VulkanResourceTracker();
+	~VulkanResourceTracker();
+
+	// Start tracking the image, all its subresources are in the initial layout
+	void registerImage(VkImage image, uint32_t mipLevels, uint32_t layerCount, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+	void unregisterImage(VkImage image);
+	inline bool isRegistered(VkImage image) { return images.find(image) != images.end(); }
+
+	// Add to the builder the barriers moving the image range to the layout for 
+	// the given stages and accesses, the range is then tracked in that state.
+	void useImage(VulkanBarrierBuilder& barriers, VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+		VkPipelineStageFlags stageMask, VkAccessFlags accessMask);
+
+	// Same with the stages and accesses derived from the layout
+	void useImage(VulkanBarrierBuilder& barriers, VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+		VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	// Record a state reached without the tracker, by a render pass or a queue family ownership transfer
+	void setImageState(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+		VkPipelineStageFlags stageMask, VkAccessFlags accessMask);
+
+	// State of a mip level and array layer
+	struct SubresourceState {
+		VkImageLayout			layout;
+		VkPipelineStageFlags	stageMask;		// Stages of the uses since the last barrier
+		VkAccessFlags			accessMask;		// Accesses of the uses since the last barrier
+	};
+
+	// Current state of a subresource
+	const SubresourceState& getSubresourceState(VkImage image, uint32_t mipLevel = 0, uint32_t arrayLayer = 0);
+
+	// Current layout of a subresource
+	VkImageLayout getImageLayout(VkImage image, uint32_t mipLevel = 0, uint32_t arrayLayer = 0);
+
+private:
+	struct ImageState {
+		uint32_t						mipLevels;
+		uint32_t						layerCount;
+		std::vector<SubresourceState>	subresources;	// Indexed by mip level * layerCount + array layer
+	};
+
+	ImageState& getImageState(VkImage image);
+
+	std::map<VkImage, ImageState>	images;
+};
@@ -25,13 +25,48 @@
 
 #pragma once
 #include "Headers.h"
+#include "VulkanShaderReflection.h"
+
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+// Prefix of the files caching the SPIR-V compiled from GLSL, the file names
+// end with the hash of the source, stage and compiler options
+#define SHADER_CACHE_FILE_PREFIX "spirv_cache_"
+
+// Bump to invalidate the cached SPIR-V, e.g. when glslang is upgraded
+#define SHADER_CACHE_VERSION 1
+#endif
+
+// Number of shader stages held by VulkanShader, vertex and fragment
+#define SHADER_STAGE_COUNT 2
+
+// Specialization constants of a shader stage, the values are packed in the order they are set
+struct SpecializationConstants {
+	std::vector<VkSpecializationMapEntry>	entries;
+	std::vector<uint8_t>					data;
+	VkSpecializationInfo					info;		// Points into the vectors above
+};
+
+// Copy of the shader stages owning their specialization constants, taken when a 
+// pipeline is scheduled. The constants set on the shader afterwards don't affect
+// it, copying the snapshot points the stages at the constants of the copy.
+struct ShaderStagesSnapshot {
+	VkPipelineShaderStageCreateInfo	stages[SHADER_STAGE_COUNT];
+	SpecializationConstants			specializations[SHADER_STAGE_COUNT];
+
+	ShaderStagesSnapshot() {}
+	ShaderStagesSnapshot(const ShaderStagesSnapshot& other) { *this = other; }
+	ShaderStagesSnapshot& operator=(const ShaderStagesSnapshot& other);
+
+	// Point the specialized stages at the constants of the snapshot
+	void bindSpecializations();
+};
 
 // Shader class managing the shader conversion, compilation, linking
 class VulkanShader
 {
 public:
 	// Constructor
-	VulkanShader() {}
+	VulkanShader();
 	
 	// Destructor
 	~VulkanShader() {}
@@ -42,10 +77,26 @@ public:
 	// Kill the shader when not required
 	void destroyShaders();
 
+	// Set the value of the constant_id of a stage, the pipelines created afterwards
+	// are specialized with it. Booleans are stored as VkBool32, as SPIR-V expects.
+	// The pipelines already scheduled by createPipelines() compile a snapshot.
+	template<typename T>
+	void setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantID, T value);
+	void setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantID, bool value);
+
+	// Remove all the specialization constants of a stage
+	void clearSpecializationConstants(VkShaderStageFlagBits stage);
+
+	// Copy the stages and their current specialization constants
+	ShaderStagesSnapshot getStagesSnapshot() const;
+
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
 	// Convert GLSL shader to SPIR-V shader
 	bool GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv);
 
+	// Fetch the SPIR-V from the disk cache, GLSLtoSPV() is only invoked on a miss
+	bool GLSLtoSPVCached(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv);
+
 	// Entry point to build the shaders
 	void buildShader(const char *vertShaderText, const char *fragShaderText);
 
@@ -55,8 +106,53 @@ public:
 
 	// Initialize the TBuitInResource
 	void initializeResources(TBuiltInResource &Resources);
+
+private:
+	// Name of the cache file of the shader, see SHADER_CACHE_FILE_PREFIX
+	std::string getCacheFileName(const VkShaderStageFlagBits shaderType, const char *pshader);
+
+	bool glslangInitialized;	// glslang is only initialized on a cache miss
 #endif
 
+private:
+	// Index of the stage in shaderStages
+	uint32_t getStageIndex(VkShaderStageFlagBits stage);
+
+	// Point the stage create info at its specialization constants, if any
+	void updateSpecializationInfo(uint32_t stageIndex);
+
+	SpecializationConstants specializations[SHADER_STAGE_COUNT];
+
+public:
 	// Vk structure storing vertex & fragment shader information
-	VkPipelineShaderStageCreateInfo shaderStages[2];
+	VkPipelineShaderStageCreateInfo shaderStages[SHADER_STAGE_COUNT];
+
+	// Interface of the vertex and fragment stages, reflected when the modules are built
+	VulkanShaderReflection reflection;
 };
+
+template<typename T>
+void VulkanShader::setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantID, T value)
+{
+	SpecializationConstants& constants = specializations[getStageIndex(stage)];
+
+	// Overwrite the constant if it is already set with the same size
+	for each (const VkSpecializationMapEntry& entry in constants.entries)
+	{
+		if (entry.constantID == constantID) {
+			assert(entry.size == sizeof(T));
+			memcpy(&constants.data[entry.offset], &value, sizeof(T));
+			return;
+		}
+	}
+
+	VkSpecializationMapEntry entry;
+	entry.constantID	= constantID;
+	entry.offset		= (uint32_t)constants.data.size();
+	entry.size			= sizeof(T);
+	constants.entries.push_back(entry);
+	constants.data.resize(constants.data.size() + sizeof(T));
+	memcpy(&constants.data[entry.offset], &value, sizeof(T));
+
+	updateSpecializationInfo(getStageIndex(stage));
+}
@@ -0,0 +1,75 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+
+// Descriptor used by a shader, the stage flags accumulate the stages using it
+struct ReflectedBinding {
+	uint32_t			set;
+	uint32_t			binding;
+	VkDescriptorType	descriptorType;
+	uint32_t			descriptorCount;
+	VkShaderStageFlags	stageFlags;
+};
+
+// Input variable of the vertex stage, a matrix occupies one location per column
+struct ReflectedInput {
+	uint32_t	location;
+	VkFormat	format;
+};
+
+// The shader reflection parses the SPIR-V words of the shader modules and 
+// extracts the interface the host must match: the descriptor bindings, the
+// push constant blocks and the vertex inputs. The reflections of the stages
+// of a program are merged into one describing the whole pipeline.
+class VulkanShaderReflection
+{
+public:
+	VulkanShaderReflection();
+	~VulkanShaderReflection();
+
+	// Parse the SPIR-V module of a stage and merge its interface, returns false 
+	// if the words are not a valid module or conflict with the merged stages
+	bool reflect(const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stage);
+
+	// Merge the interface of another shader, returns false on a conflicting binding or input
+	bool merge(const VulkanShaderReflection& other);
+
+	// Forget the reflected interface
+	void clear();
+
+	// Layout bindings of a descriptor set sorted by binding number. The uniform buffers
+	// are returned as dynamic uniform buffers if requested, SPIR-V doesn't tell them apart.
+	void getDescriptorSetLayoutBindings(uint32_t set, bool dynamicUniformBuffers, std::vector<VkDescriptorSetLayoutBinding>& layoutBindings) const;
+
+	// Number of descriptor sets used, the highest set number plus one
+	uint32_t getDescriptorSetCount() const;
+
+public:
+	std::vector<ReflectedBinding>		bindings;
+	std::vector<VkPushConstantRange>	pushConstantRanges;	// One range per stage
+	std::vector<ReflectedInput>			inputs;				// Vertex stage inputs sorted by location
+};
@@ -0,0 +1,133 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanBarrierBuilder.h"
+
+class VulkanDevice;
+class VulkanProfiler;
+
+// Size of the persistently mapped staging memory shared by all uploads
+#define STAGING_RING_SIZE (64 * 1024 * 1024)
+
+// The staging ring is a host visible buffer used as a circular queue for 
+// uploads. The source data is copied into the ring and transfer commands 
+// are recorded into an upload command buffer. Once submitted, the ring space 
+// of the command buffer is retired when its fence is signaled. Uploads bigger
+// than the ring are split into chunks spread over multiple submissions.
+// When the device has a transfer only queue the uploads are submitted there,
+// the uploaded resources are released by the transfer queue family and 
+// acquired by the graphics queue family after a semaphore handoff.
+// The image copies are recorded at submission between the transitions to 
+// the transfer layout and the transitions of the finished uploads, hence 
+// each command buffer records at most two merged pipeline barriers.
+class VulkanStagingRing
+{
+public:
+	VulkanStagingRing();
+	~VulkanStagingRing();
+
+	// Create the ring buffer and its command pool, does nothing if already created
+	void create(VkDeviceSize size = STAGING_RING_SIZE);
+	void destroy();
+
+	// Stage the data and record the copy into the destination buffer
+	void copyToBuffer(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	// Barriers recorded before the image copies at the next submission, the 
+	// images are transitioned here to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+	VulkanBarrierBuilder& getCopyBarriers();
+
+	// Stage the data and queue the copy of each region into the image in 
+	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL layout. The bufferOffset of the regions
+	// is relative to data, regions must be tightly packed and sorted by their offset.
+	void copyToImage(VkImage image, const void* data, VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions);
+
+	// Make the uploaded buffer available to the graphics queue for the given accesses.
+	// The barriers of the finished uploads are merged and recorded at submission.
+	void finishBufferUpload(VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+	// Transition the uploaded image from VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL to the 
+	// new layout and make it available to the graphics queue for the given accesses
+	void finishImageUpload(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout newLayout,
+		VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+	// Submit the recorded upload commands, the function does not wait for their completion
+	void submit();
+
+	// Uploads are executed on the transfer only queue
+	inline bool usesTransferQueue() { return dedicatedQueue; }
+
+	// Time the image uploads of each submission, the profiler queries 
+	// belong to the graphics queue and can't time the transfer queue.
+	inline void setProfiler(VulkanProfiler* profilerObj) { profiler = profilerObj; }
+
+	// Wait until all the submitted uploads are finished
+	void waitIdle();
+
+private:
+	// An upload command buffer and the ring space it consumes
+	struct Submission {
+		VkCommandBuffer	cmdBuf;
+		VkCommandBuffer	acquireCmdBuf;	// Graphics queue command buffer acquiring the uploaded resources
+		VkSemaphore		semaphore;		// Signaled by the transfer queue, waited by the graphics queue
+		VkFence			fence;
+		VkDeviceSize	end;			// Ring head position when the command buffer was submitted
+	};
+
+	// Image copy queued until the submission
+	struct ImageCopy {
+		VkImage				image;
+		VkBufferImageCopy	region;
+	};
+
+	// Returns the upload command buffer being recorded, begins a new one if needed
+	VkCommandBuffer getCommandBuffer();
+	VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment);
+	void retire(bool wait);
+
+	VulkanDevice*				deviceObj;
+	VulkanProfiler*				profiler;
+	VkCommandPool				cmdPool;
+	VkCommandPool				acquireCmdPool;	// Graphics queue family pool of the acquire command buffers
+	bool						dedicatedQueue;	// Uploads go through the transfer only queue
+	VkBuffer					buffer;			// Ring buffer
+	MemoryAllocation			memory;			// Persistently mapped ring memory
+	VkDeviceSize				ringSize;
+	VkDeviceSize				head;			// Monotonic position of the next allocation
+	VkDeviceSize				tail;			// Monotonic position of the oldest range in use
+	VkDeviceSize				copyAlignment;	// Alignment of the staged ranges
+	uint32_t					bandAlignment;	// Row alignment of the bands of the images split over several copies
+	Submission					recording;		// Command buffer being recorded, if cmdBuf is not null
+	std::vector<Submission>		inFlight;		// Submitted command buffers, oldest first
+	std::vector<Submission>		freeList;		// Retired command buffers and fences for reuse
+
+	std::vector<ImageCopy>		imageCopies;		// Recorded between the copy and the finish barriers at the next submission
+	VulkanBarrierBuilder		copyBarriers;		// Recorded before the image copies of the command buffer at the next submission
+	VulkanBarrierBuilder		finishBarriers;		// Recorded after the copies of the command buffer at the next submission
+	VulkanBarrierBuilder		acquireBarriers;	// Ownership acquires executed on the graphics queue at the next submission
+};
@@ -26,6 +26,14 @@
 #pragma once
 
 #include "Headers.h"
+#include "VulkanMemoryAllocator.h"
+
+// Number of offscreen color images rendered in round robin in headless mode
+#define HEADLESS_IMAGE_COUNT 3
+
+// Color format of the offscreen images in headless mode
+#define HEADLESS_COLOR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+
 class VulkanInstance;
 class VulkanDevice;
 class VulkanRenderer;
@@ -64,6 +72,9 @@ struct SwapChainPrivateVariables
 	std::vector<VkImage>		swapchainImages;
 
 	std::vector<VkSurfaceFormatKHR> surfFormats;
+
+	// Memory of the offscreen color images, headless mode only
+	std::vector<MemoryAllocation> offscreenMemory;
 };
 
 struct SwapChainPublicVariables
@@ -101,6 +112,13 @@ public:
 	void destroySwapChain();
 	void setSwapChainExtent(uint32_t swapChainWidth, uint32_t swapChainHeight);
 
+	// Get the index of the next color image to draw into. In headless mode the 
+	// offscreen images are used round robin and the semaphore is not signaled.
+	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t* imageIndex);
+
+	// Queue the image for presentation, does nothing in headless mode
+	VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore drawingCompleteSemaphore);
+
 // Private member variables
 private:
 	VkResult createSwapChainExtensions();
@@ -111,6 +129,7 @@ private:
 	void managePresentMode();
 	void createSwapChainColorImages();
 	void createColorImageView(const VkCommandBuffer& cmd);
+	void createOffscreenColorImages();
 
 // Public member variables
 public:
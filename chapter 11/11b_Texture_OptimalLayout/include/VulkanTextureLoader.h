@@ -0,0 +1,70 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include "VulkanJobSystem.h"
+
+struct TextureData;
+
+// The texture loader decodes KTX/DDS files in jobs of the job system. The 
+// decoded images are fetched by the render thread which uploads them to the
+// device, the file I/O and decoding never block the rendering.
+class VulkanTextureLoader
+{
+public:
+	// A texture file to decode and the texture object it is uploaded into
+	struct Request {
+		std::string			filename;
+		TextureData*		texture;
+		VkImageUsageFlags	imageUsageFlags;
+		VkFormat			format;
+		gli::texture2D*		image;		// Decoded image, owned by the caller of fetchDecoded()
+	};
+
+	VulkanTextureLoader();
+	~VulkanTextureLoader();
+
+	// Decode the files with the jobs of the given job system
+	void create(VulkanJobSystem* jobSystem);
+
+	// Wait for the decoding jobs, the decoded images not yet fetched are dropped
+	void destroy();
+
+	// Queue the file for decoding
+	void load(const char* filename, TextureData* texture, VkImageUsageFlags imageUsageFlags, VkFormat format);
+
+	// Retrieve a decoded texture without waiting, returns false if none is ready
+	bool fetchDecoded(Request* decoded);
+
+private:
+	void decode(Request request);
+
+	VulkanJobSystem*			jobSystem;
+	std::vector<JobHandle>		jobs;		// Decoding jobs, waited for on destruction
+	std::mutex					mutex;		// Guards the members below
+	std::deque<Request>			decoded;	// Decoded images waiting to be uploaded
+	bool						quit;
+};
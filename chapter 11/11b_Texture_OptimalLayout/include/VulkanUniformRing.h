@@ -0,0 +1,73 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Headers.h"
+#include "VulkanMemoryAllocator.h"
+
+class VulkanDevice;
+
+// Size of the uniform memory available to each frame in flight
+#define UNIFORM_RING_FRAME_SIZE (1024 * 1024)
+
+// The uniform ring is a persistently mapped uniform buffer divided in one
+// region per frame in flight. Each frame the drawables bump-allocate their
+// uniform data from the region of the frame and bind it with a dynamic 
+// offset. A region is rewritten only once the fence of its frame is 
+// signaled, so the host never overwrites the data the GPU is reading.
+class VulkanUniformRing
+{
+public:
+	VulkanUniformRing();
+	~VulkanUniformRing();
+
+	// Create the ring buffer, does nothing if already created
+	void create(uint32_t frameCount, VkDeviceSize frameSize = UNIFORM_RING_FRAME_SIZE);
+	void destroy();
+
+	// Start allocating from the region of the frame, the fence of the frame must be signaled
+	void beginFrame(uint32_t frameIndex);
+
+	// Copy the data in the frame region and return its dynamic offset in the
+	// buffer, the offset is aligned to minUniformBufferOffsetAlignment.
+	// Can be called from any thread.
+	uint32_t push(const void* data, VkDeviceSize size);
+
+	// Make the data of the frame visible to the device before its submission
+	void flush();
+
+	inline VkBuffer getBuffer() { return buffer; }
+
+private:
+	VulkanDevice*		deviceObj;
+	VkBuffer			buffer;			// Ring buffer
+	MemoryAllocation	memory;			// Persistently mapped ring memory
+	VkDeviceSize		frameSize;		// Size of each frame region
+	VkDeviceSize		alignment;		// Alignment of the allocations
+	bool				coherent;		// Memory does not need explicit flushes
+	VkDeviceSize		frameBase;		// Offset of the current frame region
+	VkDeviceSize		frameOffset;	// Offset of the next allocation in the frame region
+	std::mutex			mutex;			// Guards the allocation
+};
@@ -25,6 +25,7 @@
 
 #pragma once
 #include "Headers.h"
+#include "VulkanMemoryAllocator.h"
 
 /***************COMMAND BUFFER WRAPPERS***************/
 class CommandBufferMgr
@@ -36,15 +37,19 @@ public:
 	static void submitCommandBuffer(const VkQueue& queue, const VkCommandBuffer* cmdBufList, const VkSubmitInfo* submitInfo = NULL, const VkFence& fence = VK_NULL_HANDLE);
 };
 
+// Read the whole file into a malloc'ed buffer, returns NULL if the file is missing or empty
 void* readFile(const char *spvFileName, size_t *fileSize);
 
+// Write the data into a temporary file moved over the destination, a crash
+// while writing never leaves a truncated file behind. Returns false on failure.
+bool writeFile(const char *fileName, const void* data, size_t size);
+
 /***************TEXTURE WRAPPERS***************/
 struct TextureData{
 	VkSampler				sampler;
 	VkImage					image;
 	VkImageLayout			imageLayout;
-	VkMemoryAllocateInfo	memoryAlloc;
-	VkDeviceMemory			mem;
+	MemoryAllocation		mem;
 	VkImageView				view;
 	uint32_t				mipMapLevels;
 	uint32_t				layerCount;
@@ -45,6 +45,7 @@ VulkanApplication::VulkanApplication()
 	rendererObj = NULL;
 	isPrepared = false;
 	isResizing = false;
+	isHeadless = false;
 }
 
 VulkanApplication::~VulkanApplication()
@@ -126,6 +127,9 @@ void VulkanApplication::initialize()
 {
 	char title[] = "Hello World!!!";
 
+	// Start the workers first, every subsystem may schedule jobs
+	jobSystem.create();
+
 	// Check if the supplied layer are support or not
 	instanceObj.layerExtension.areLayersSupported(layerNames);
 
@@ -147,8 +151,15 @@ void VulkanApplication::initialize()
 
 	if (!rendererObj) {
 		rendererObj = new VulkanRenderer(this, deviceObj);
-		// Create an empy window 500x500
-		rendererObj->createPresentationWindow(500, 500);
+		if (isHeadless) {
+			// Offscreen images of 500x500
+			rendererObj->width	= 500;
+			rendererObj->height	= 500;
+		}
+		else {
+			// Create an empy window 500x500
+			rendererObj->createPresentationWindow(500, 500);
+		}
 		// Initialize swapchain
 		rendererObj->getSwapChain()->intializeSwapChain();
 	}
@@ -164,29 +175,28 @@ void VulkanApplication::resize()
 	
 	isResizing = true;
 
+	// Only the extent dependent objects are rebuilt, the buffers, textures, descriptors,
+	// render pass and pipelines are kept alive. The drawing command buffers are 
+	// recorded every frame and pick up the new framebuffers and extent.
 	vkDeviceWaitIdle(deviceObj->device);
 	rendererObj->destroyFramebuffers();
-	rendererObj->destroyCommandPool();
-	rendererObj->destroyPipeline();
-	rendererObj->getPipelineObject()->destroyPipelineCache();
-	for each (VulkanDrawable* drawableObj in *rendererObj->getDrawingItems())
-	{
-		drawableObj->destroyDescriptor();
-	}
-	rendererObj->destroyRenderpass();
 	rendererObj->getSwapChain()->destroySwapChain();
-	rendererObj->destroyDrawableVertexBuffer();
-	rendererObj->destroyDrawableUniformBuffer();
-	rendererObj->destroyTextureResource();
 	rendererObj->destroyDepthBuffer();
-	rendererObj->initialize();
-	prepare();
+	rendererObj->resize();
 
 	isResizing = false;
 }
 
 void VulkanApplication::deInitialize()
 {
+	// Frames may still be in flight, let the device finish them
+	vkDeviceWaitIdle(deviceObj->device);
+
+	// Gather the last GPU timings and export the statistics
+	rendererObj->getProfiler()->flush();
+	rendererObj->getProfiler()->exportJSON();
+	rendererObj->getProfiler()->exportCSV();
+
 	// Destroy all the pipeline objects
 	rendererObj->destroyPipeline();
 
@@ -199,24 +209,32 @@ void VulkanApplication::deInitialize()
 	}
 
 	rendererObj->getShader()->destroyShaders();
+	rendererObj->destroyRenderGraph();
 	rendererObj->destroyFramebuffers();
 	rendererObj->destroyRenderpass();
 	rendererObj->destroyDrawableVertexBuffer();
-	rendererObj->destroyDrawableUniformBuffer();
+	rendererObj->destroyUniformRing();
 
-	rendererObj->destroyDrawableCommandBuffer();
+	rendererObj->destroyFrameCommandBuffers();
+	rendererObj->destroyRecordingThreads();
 	rendererObj->destroyDepthBuffer();
 	rendererObj->getSwapChain()->destroySwapChain();
 	rendererObj->destroyCommandBuffer();
-	rendererObj->destroyDrawableSynchronizationObjects();
+	rendererObj->destroyFrameSynchronizationObjects();
 	rendererObj->destroyCommandPool();
-	rendererObj->destroyPresentationWindow();
+	if (!isHeadless) {
+		rendererObj->destroyPresentationWindow();
+	}
+	rendererObj->destroyTextureLoader();
 	rendererObj->destroyTextureResource();
+	rendererObj->destroyStagingRing();
+	rendererObj->destroyProfiler();
 	deviceObj->destroyDevice();
 	if (debugFlag) {
 		instanceObj.layerExtension.destroyDebugReportCallback();
 	}
 	instanceObj.destroyInstance();
+	jobSystem.destroy();
 }
 
 void VulkanApplication::prepare()
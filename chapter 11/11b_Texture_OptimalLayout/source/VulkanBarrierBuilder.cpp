@@ -0,0 +1,185 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanBarrierBuilder.h"
+
+// Accesses making the writes available, the reads of the source need no availability
+static const VkAccessFlags WRITE_ACCESS_MASK =	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+												VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+												VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+VulkanBarrierBuilder::VulkanBarrierBuilder()
+{
+	srcStages = 0;
+	dstStages = 0;
+}
+
+VulkanBarrierBuilder::~VulkanBarrierBuilder()
+{
+}
+
+void VulkanBarrierBuilder::getLayoutStageAccess(VkImageLayout layout, bool isSource, VkPipelineStageFlags shaderStages,
+	VkPipelineStageFlags* stageMask, VkAccessFlags* accessMask)
+{
+	switch (layout)
+	{
+	// The previous content is discarded, nothing to wait for
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		*stageMask	= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		*accessMask	= 0;
+		break;
+
+	// Written by the host before the transition
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		*stageMask	= VK_PIPELINE_STAGE_HOST_BIT;
+		*accessMask	= VK_ACCESS_HOST_WRITE_BIT;
+		break;
+
+	// Storage image accessed by the shaders
+	case VK_IMAGE_LAYOUT_GENERAL:
+		*stageMask	= shaderStages;
+		*accessMask	= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		*stageMask	= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		*accessMask	= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		*stageMask	= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		*accessMask	= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		*stageMask	= shaderStages | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		*accessMask	= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		*stageMask	= shaderStages;
+		*accessMask	= VK_ACCESS_SHADER_READ_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		*stageMask	= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		*accessMask	= VK_ACCESS_TRANSFER_READ_BIT;
+		break;
+
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		*stageMask	= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		*accessMask	= VK_ACCESS_TRANSFER_WRITE_BIT;
+		break;
+
+	// The presentation engine is synchronized with semaphores, the image 
+	// is released at the end of the pipe and acquired by the color output.
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		*stageMask	= isSource ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		*accessMask	= 0;
+		break;
+
+	default:
+		*stageMask	= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		*accessMask	= VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		break;
+	}
+
+	if (isSource) {
+		*accessMask &= WRITE_ACCESS_MASK;
+	}
+}
+
+void VulkanBarrierBuilder::transitionImage(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags shaderStages)
+{
+	VkPipelineStageFlags	srcStageMask, dstStageMask;
+	VkAccessFlags			srcAccessMask, dstAccessMask;
+
+	getLayoutStageAccess(oldLayout, true, shaderStages, &srcStageMask, &srcAccessMask);
+	getLayoutStageAccess(newLayout, false, shaderStages, &dstStageMask, &dstAccessMask);
+
+	imageBarrier(image, subresourceRange, oldLayout, newLayout, srcStageMask, srcAccessMask, dstStageMask, dstAccessMask);
+}
+
+void VulkanBarrierBuilder::imageBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask,
+	uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex)
+{
+	VkImageMemoryBarrier imgMemoryBarrier = {};
+	imgMemoryBarrier.sType					= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imgMemoryBarrier.pNext					= NULL;
+	imgMemoryBarrier.srcAccessMask			= srcAccessMask;
+	imgMemoryBarrier.dstAccessMask			= dstAccessMask;
+	imgMemoryBarrier.oldLayout				= oldLayout;
+	imgMemoryBarrier.newLayout				= newLayout;
+	imgMemoryBarrier.srcQueueFamilyIndex	= srcQueueFamilyIndex;
+	imgMemoryBarrier.dstQueueFamilyIndex	= dstQueueFamilyIndex;
+	imgMemoryBarrier.image					= image;
+	imgMemoryBarrier.subresourceRange		= subresourceRange;
+
+	imageBarriers.push_back(imgMemoryBarrier);
+	srcStages |= srcStageMask;
+	dstStages |= dstStageMask;
+}
+
+void VulkanBarrierBuilder::bufferBarrier(VkBuffer buffer,
+	VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask,
+	uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex)
+{
+	VkBufferMemoryBarrier bufferBarrier = {};
+	bufferBarrier.sType					= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.pNext					= NULL;
+	bufferBarrier.srcAccessMask			= srcAccessMask;
+	bufferBarrier.dstAccessMask			= dstAccessMask;
+	bufferBarrier.srcQueueFamilyIndex	= srcQueueFamilyIndex;
+	bufferBarrier.dstQueueFamilyIndex	= dstQueueFamilyIndex;
+	bufferBarrier.buffer				= buffer;
+	bufferBarrier.offset				= 0;
+	bufferBarrier.size					= VK_WHOLE_SIZE;
+
+	bufferBarriers.push_back(bufferBarrier);
+	srcStages |= srcStageMask;
+	dstStages |= dstStageMask;
+}
+
+void VulkanBarrierBuilder::flush(VkCommandBuffer cmd)
+{
+	if (empty()) {
+		return;
+	}
+
+	// Stage masks must not be empty
+	VkPipelineStageFlags srcStageMask = srcStages ? srcStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkPipelineStageFlags dstStageMask = dstStages ? dstStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+	vkCmdPipelineBarrier(cmd, srcStageMask, dstStageMask, 0, 0, NULL,
+		(uint32_t)bufferBarriers.size(), bufferBarriers.data(),
+		(uint32_t)imageBarriers.size(), imageBarriers.data());
+
+	bufferBarriers.clear();
+	imageBarriers.clear();
+	srcStages = 0;
+	dstStages = 0;
+}
@@ -59,15 +59,19 @@ void VulkanDescriptor::destroyDescriptor()
 
 void VulkanDescriptor::destroyDescriptorLayout()
 {
+	// The layouts are shared with the other descriptors with the same bindings
+	VulkanPipeline* pipelineObj = VulkanApplication::GetInstance()->rendererObj->getPipelineObject();
 	for (int i = 0; i < descLayout.size(); i++) {
-		vkDestroyDescriptorSetLayout(deviceObj->device, descLayout[i], NULL);
+		pipelineObj->releaseDescriptorSetLayout(descLayout[i]);
 	}
 	descLayout.clear();
 }
 
 void VulkanDescriptor::destroyPipelineLayouts()
 {
-	vkDestroyPipelineLayout(deviceObj->device, pipelineLayout, NULL);
+	VulkanPipeline* pipelineObj = VulkanApplication::GetInstance()->rendererObj->getPipelineObject();
+	pipelineObj->releasePipelineLayout(pipelineLayout);
+	pipelineLayout = VK_NULL_HANDLE;
 }
 
 void VulkanDescriptor::destroyDescriptorPool()
@@ -29,7 +29,11 @@
 
 VulkanDevice::VulkanDevice(VkPhysicalDevice* physicalDevice) 
 {
-	gpu = physicalDevice;
+	gpu					= physicalDevice;
+	memoryAllocator		= NULL;
+	queue				= VK_NULL_HANDLE;
+	transferQueue		= VK_NULL_HANDLE;
+	transferQueueIndex	= UINT32_MAX;
 }
 
 VulkanDevice::~VulkanDevice() 
@@ -46,12 +50,16 @@ VkResult VulkanDevice::createDevice(std::vector<const char *>& layers, std::vect
 
 	VkResult result;
 	float queuePriorities[1]			= { 0.0 };
-	VkDeviceQueueCreateInfo queueInfo	= {};
-	queueInfo.queueFamilyIndex			= graphicsQueueIndex;  
-	queueInfo.sType						= VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queueInfo.pNext						= NULL;
-	queueInfo.queueCount				= 1;
-	queueInfo.pQueuePriorities			= queuePriorities;
+	VkDeviceQueueCreateInfo queueInfo[2]= {};
+	queueInfo[0].queueFamilyIndex		= graphicsQueueIndex;  
+	queueInfo[0].sType					= VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo[0].pNext					= NULL;
+	queueInfo[0].queueCount				= 1;
+	queueInfo[0].pQueuePriorities		= queuePriorities;
+
+	// Second queue for the uploads, from the transfer only family
+	queueInfo[1]						= queueInfo[0];
+	queueInfo[1].queueFamilyIndex		= transferQueueIndex;
 
 
 	vkGetPhysicalDeviceFeatures(*gpu, &deviceFeatures);
@@ -62,8 +70,8 @@ VkResult VulkanDevice::createDevice(std::vector<const char *>& layers, std::vect
 	VkDeviceCreateInfo deviceInfo		= {};
 	deviceInfo.sType					= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceInfo.pNext					= NULL;
-	deviceInfo.queueCreateInfoCount		= 1;
-	deviceInfo.pQueueCreateInfos		= &queueInfo;
+	deviceInfo.queueCreateInfoCount		= hasTransferQueue() ? 2 : 1;
+	deviceInfo.pQueueCreateInfos		= queueInfo;
 	deviceInfo.enabledLayerCount		= 0;
 	deviceInfo.ppEnabledLayerNames		= NULL;											// Device layers are deprecated
 	deviceInfo.enabledExtensionCount	= (uint32_t)extensions.size();
@@ -73,6 +81,8 @@ VkResult VulkanDevice::createDevice(std::vector<const char *>& layers, std::vect
 	result = vkCreateDevice(*gpu, &deviceInfo, NULL, &device);
 	assert(result == VK_SUCCESS);
 
+	memoryAllocator = new VulkanMemoryAllocator(this);
+
 	return result;
 }
 
@@ -93,6 +103,39 @@ bool VulkanDevice::memoryTypeFromProperties(uint32_t typeBits, VkFlags requireme
 	return false;
 }
 
+bool VulkanDevice::memoryTypeFromProperties(uint32_t typeBits, VkFlags requirementsMask, VkFlags preferredMask, uint32_t *typeIndex)
+{
+	// Prefer the memory type offering the optional properties as well, 
+	// fall back on the first type satisfying the mandatory properties.
+	if (memoryTypeFromProperties(typeBits, requirementsMask | preferredMask, typeIndex)) {
+		return true;
+	}
+	return memoryTypeFromProperties(typeBits, requirementsMask, typeIndex);
+}
+
+bool VulkanDevice::isDeviceLocalMemoryMappable(uint32_t typeBits, uint32_t* typeIndex)
+{
+	const VkFlags requirementsMask = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if (!(typeBits & (1 << i)) ||
+			(memoryProperties.memoryTypes[i].propertyFlags & requirementsMask) != requirementsMask) {
+			continue;
+		}
+
+		// Integrated GPUs expose the system memory as a device local heap and
+		// a resizable BAR exposes the whole video memory to the host. In both
+		// cases the host writes go to the memory the GPU reads from. The type is
+		// returned as the first type with these flags may be in the small BAR heap.
+		const VkMemoryHeap& heap = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex];
+		if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > MAPPABLE_DEVICE_LOCAL_HEAP_MIN_SIZE) {
+			*typeIndex = i;
+			return true;
+		}
+	}
+	return false;
+}
+
 void VulkanDevice::getPhysicalDeviceQueuesAndProperties()
 {
 	// Query queue families count with pass NULL as second parameter.
@@ -137,11 +180,28 @@ uint32_t VulkanDevice::getGraphicsQueueHandle()
 	// Assert if there is no queue found.
 	assert(found);
 
+	// Look for a family supporting transfers but neither graphics nor compute,
+	// on discrete GPUs it is backed by the DMA engines which copy the data 
+	// while the graphics queue keeps rendering.
+	transferQueueIndex = UINT32_MAX;
+	for (unsigned int i = 0; i < queueFamilyCount; i++) {
+		VkQueueFlags flags = queueFamilyProps[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			transferQueueIndex = i;
+			break;
+		}
+	}
+
 	return 0;
 }
 
 void VulkanDevice::destroyDevice()
 {
+	if (memoryAllocator) {
+		memoryAllocator->destroy();
+		delete memoryAllocator;
+		memoryAllocator = NULL;
+	}
 	vkDestroyDevice(device, NULL);
 }
 
@@ -152,4 +212,8 @@ void VulkanDevice::getDeviceQueue()
 	// Parminder: this depends on intialiing the SwapChain to 
 	// get the graphics queue with presentation support
 	vkGetDeviceQueue(device, graphicsQueueWithPresentIndex, 0, &queue);
+
+	if (hasTransferQueue()) {
+		vkGetDeviceQueue(device, transferQueueIndex, 0, &transferQueue);
+	}
 }
@@ -0,0 +1,240 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanJobSystem.h"
+
+// Index of the worker running on the thread, the other threads use the shared deque
+static thread_local uint32_t currentWorkerIndex = UINT32_MAX;
+
+VulkanJobSystem::VulkanJobSystem()
+{
+	pendingJobs		= 0;
+	backgroundQueue	= NULL;
+	quit			= false;
+}
+
+VulkanJobSystem::~VulkanJobSystem()
+{
+}
+
+void VulkanJobSystem::create(uint32_t workerCount)
+{
+	if (!workers.empty()) {
+		return;
+	}
+
+	if (workerCount == 0) {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = std::max<uint32_t>(1, hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+	}
+
+	// One deque per worker plus the shared one
+	for (uint32_t i = 0; i <= workerCount; i++) {
+		queues.push_back(new JobQueue);
+	}
+	backgroundQueue = new JobQueue;
+
+	quit = false;
+	for (uint32_t i = 0; i < workerCount; i++) {
+		workers.push_back(std::thread(&VulkanJobSystem::workerMain, this, i));
+	}
+}
+
+void VulkanJobSystem::destroy()
+{
+	if (workers.empty()) {
+		return;
+	}
+
+	// Drain the queued jobs, they may hold resources released by their function
+	while (executeNext(true)) {}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quit = true;
+	}
+	wakeUp.notify_all();
+
+	for (uint32_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+
+	for each (JobQueue* queue in queues)
+	{
+		delete queue;
+	}
+	queues.clear();
+	delete backgroundQueue;
+	backgroundQueue = NULL;
+}
+
+JobHandle VulkanJobSystem::createJob(std::function<void()> function, const JobHandle& parent)
+{
+	JobHandle job		= std::make_shared<Job>();
+	job->function		= function;
+	job->parent			= parent;
+	job->unfinished		= 1;
+
+	// The parent is not finished until this child is
+	if (parent) {
+		parent->unfinished++;
+	}
+
+	return job;
+}
+
+void VulkanJobSystem::run(const JobHandle& job)
+{
+	assert(!queues.empty());
+	push(queues[getQueueIndex()], job);
+}
+
+void VulkanJobSystem::push(JobQueue* queue, const JobHandle& job)
+{
+	// Count before publishing the job, the thread popping it decrements the counter.
+	// Under the sleep lock so that a worker going idle can't miss the job.
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		pendingJobs++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->jobs.push_back(job);
+	}
+	wakeUp.notify_one();
+}
+
+JobHandle VulkanJobSystem::schedule(std::function<void()> function, const JobHandle& parent)
+{
+	JobHandle job = createJob(function, parent);
+	run(job);
+	return job;
+}
+
+JobHandle VulkanJobSystem::scheduleBackground(std::function<void()> function)
+{
+	assert(backgroundQueue);
+
+	JobHandle job = createJob(function);
+	push(backgroundQueue, job);
+	return job;
+}
+
+void VulkanJobSystem::wait(const JobHandle& job)
+{
+	// Help with the pending jobs, the job may be one of them. The background 
+	// jobs are left to the workers, a frame never waits for a file decoding.
+	while (!isFinished(job)) {
+		if (!executeNext(false)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void VulkanJobSystem::parallelFor(uint32_t count, std::function<void(uint32_t)> function)
+{
+	JobHandle root = createJob([] {});
+	for (uint32_t i = 0; i < count; i++) {
+		schedule([function, i] { function(i); }, root);
+	}
+	run(root);
+	wait(root);
+}
+
+uint32_t VulkanJobSystem::getQueueIndex()
+{
+	return (currentWorkerIndex < workers.size()) ? currentWorkerIndex : (uint32_t)workers.size();
+}
+
+bool VulkanJobSystem::executeNext(bool background)
+{
+	JobHandle job;
+	uint32_t ownIndex = getQueueIndex();
+
+	// Latest job of the own deque first, it is likely hot in the caches
+	{
+		JobQueue* queue = queues[ownIndex];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			job = queue->jobs.back();
+			queue->jobs.pop_back();
+		}
+	}
+
+	// Otherwise steal the oldest job of another deque
+	for (uint32_t i = 1; !job && i < queues.size(); i++) {
+		JobQueue* queue = queues[(ownIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			job = queue->jobs.front();
+			queue->jobs.pop_front();
+		}
+	}
+
+	// The long running jobs last, when nothing else is pending
+	if (!job && background) {
+		std::lock_guard<std::mutex> lock(backgroundQueue->mutex);
+		if (!backgroundQueue->jobs.empty()) {
+			job = backgroundQueue->jobs.front();
+			backgroundQueue->jobs.pop_front();
+		}
+	}
+
+	if (!job) {
+		return false;
+	}
+
+	pendingJobs--;
+	job->function();
+	finish(job);
+	return true;
+}
+
+void VulkanJobSystem::finish(const JobHandle& job)
+{
+	// The last of the job and its children finishes the parent in turn
+	if (--job->unfinished == 0 && job->parent) {
+		finish(job->parent);
+	}
+}
+
+void VulkanJobSystem::workerMain(uint32_t workerIndex)
+{
+	currentWorkerIndex = workerIndex;
+
+	while (true) {
+		if (executeNext(true)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this] { return quit || pendingJobs.load() > 0; });
+		if (quit) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,275 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDevice.h"
+
+// Round up the value to the next multiple of alignment
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VulkanDevice* device)
+{
+	deviceObj = device;
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+}
+
+bool VulkanMemoryAllocator::allocate(const VkMemoryRequirements& memRqrmnt, VkFlags requirementsMask, VkFlags preferredMask, bool linear, MemoryAllocation* allocation)
+{
+	uint32_t memoryTypeIndex;
+	if (!deviceObj->memoryTypeFromProperties(memRqrmnt.memoryTypeBits, requirementsMask, preferredMask, &memoryTypeIndex)) {
+		return false;
+	}
+
+	VkMemoryPropertyFlags properties	= deviceObj->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+	VkDeviceSize alignment				= memRqrmnt.alignment ? memRqrmnt.alignment : 1;
+	VkDeviceSize size					= memRqrmnt.size;
+
+	// Flush and invalidate ranges of non-coherent memory must be aligned 
+	// to nonCoherentAtomSize, keep such ranges from sharing an atom.
+	if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		VkDeviceSize atomSize = deviceObj->gpuProps.limits.nonCoherentAtomSize;
+		alignment	= std::max(alignment, atomSize);
+		size		= alignUp(size, atomSize);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Lazily allocated memory is given per resource, a block would group
+	// attachments which the driver can otherwise commit independently.
+	if (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+		MemoryBlock* block = createBlock(size, memoryTypeIndex, linear, true);
+		return block && allocateFromBlock(block, size, alignment, allocation);
+	}
+
+	// Large resources are given their own device memory
+	VkDeviceSize blockSize = std::min<VkDeviceSize>(MEMORY_BLOCK_SIZE,
+		deviceObj->memoryProperties.memoryHeaps[deviceObj->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size / 8);
+	if (size > blockSize / 2) {
+		MemoryBlock* block = createBlock(size, memoryTypeIndex, linear, true);
+		return block && allocateFromBlock(block, size, alignment, allocation);
+	}
+
+	// First fit in the existing blocks of the same memory type and resource kind
+	for each (MemoryBlock* block in blocks) {
+		if (block->dedicated || block->memoryTypeIndex != memoryTypeIndex || block->linear != linear) {
+			continue;
+		}
+
+		if (allocateFromBlock(block, size, alignment, allocation)) {
+			return true;
+		}
+	}
+
+	MemoryBlock* block = createBlock(blockSize, memoryTypeIndex, linear, false);
+	return block && allocateFromBlock(block, size, alignment, allocation);
+}
+
+void VulkanMemoryAllocator::free(MemoryAllocation* allocation)
+{
+	MemoryBlock* block = allocation->block;
+	if (!block) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	allocation->block = NULL;
+	block->allocationCount--;
+
+	if (block->dedicated) {
+		destroyBlock(block);
+		return;
+	}
+
+	// Return the range to the free list and merge it with its neighbours
+	std::map<VkDeviceSize, VkDeviceSize>::iterator range = block->freeRanges.insert(std::make_pair(allocation->offset, allocation->size)).first;
+
+	std::map<VkDeviceSize, VkDeviceSize>::iterator next = range;
+	++next;
+	if (next != block->freeRanges.end() && range->first + range->second == next->first) {
+		range->second += next->second;
+		block->freeRanges.erase(next);
+	}
+
+	if (range != block->freeRanges.begin()) {
+		std::map<VkDeviceSize, VkDeviceSize>::iterator prev = range;
+		--prev;
+		if (prev->first + prev->second == range->first) {
+			prev->second += range->second;
+			block->freeRanges.erase(range);
+		}
+	}
+
+	// Empty blocks are kept around, resources recreated on 
+	// resize find their memory without calling the driver.
+}
+
+bool VulkanMemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkFlags requirementsMask, VkFlags preferredMask, MemoryAllocation* allocation, uint32_t memoryTypeBits)
+{
+	VkMemoryRequirements memRqrmnt;
+	vkGetBufferMemoryRequirements(deviceObj->device, buffer, &memRqrmnt);
+	memRqrmnt.memoryTypeBits &= memoryTypeBits;
+
+	if (!allocate(memRqrmnt, requirementsMask, preferredMask, true, allocation)) {
+		return false;
+	}
+
+	VkResult result = vkBindBufferMemory(deviceObj->device, buffer, allocation->memory, allocation->offset);
+	assert(result == VK_SUCCESS);
+
+	return true;
+}
+
+bool VulkanMemoryAllocator::allocateTransient(const VkMemoryRequirements& memRqrmnt, MemoryAllocation* allocation)
+{
+	return allocate(memRqrmnt, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, 0, false, allocation) ||
+		allocate(memRqrmnt, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, allocation);
+}
+
+bool VulkanMemoryAllocator::allocateTransientImageMemory(VkImage image, MemoryAllocation* allocation)
+{
+	VkMemoryRequirements memRqrmnt;
+	vkGetImageMemoryRequirements(deviceObj->device, image, &memRqrmnt);
+
+	if (!allocateTransient(memRqrmnt, allocation)) {
+		return false;
+	}
+
+	VkResult result = vkBindImageMemory(deviceObj->device, image, allocation->memory, allocation->offset);
+	assert(result == VK_SUCCESS);
+
+	return true;
+}
+
+bool VulkanMemoryAllocator::allocateImageMemory(VkImage image, VkFlags requirementsMask, VkFlags preferredMask, bool linearTiling, MemoryAllocation* allocation)
+{
+	VkMemoryRequirements memRqrmnt;
+	vkGetImageMemoryRequirements(deviceObj->device, image, &memRqrmnt);
+
+	if (!allocate(memRqrmnt, requirementsMask, preferredMask, linearTiling, allocation)) {
+		return false;
+	}
+
+	VkResult result = vkBindImageMemory(deviceObj->device, image, allocation->memory, allocation->offset);
+	assert(result == VK_SUCCESS);
+
+	return true;
+}
+
+void VulkanMemoryAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	while (!blocks.empty()) {
+		destroyBlock(blocks.back());
+	}
+}
+
+MemoryBlock* VulkanMemoryAllocator::createBlock(VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, bool dedicated)
+{
+	VkMemoryAllocateInfo memAllocInfo	= {};
+	memAllocInfo.sType					= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.pNext					= NULL;
+	memAllocInfo.allocationSize			= size;
+	memAllocInfo.memoryTypeIndex		= memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	VkResult result = vkAllocateMemory(deviceObj->device, &memAllocInfo, NULL, &memory);
+	if (result != VK_SUCCESS) {
+		return NULL;
+	}
+
+	MemoryBlock* block		= new MemoryBlock();
+	block->memory			= memory;
+	block->size				= size;
+	block->memoryTypeIndex	= memoryTypeIndex;
+	block->linear			= linear;
+	block->dedicated		= dedicated;
+	block->pMapped			= NULL;
+	block->allocationCount	= 0;
+	block->freeRanges[0]	= size;
+
+	// Host visible blocks stay mapped for their whole lifetime, a device memory 
+	// object can only be mapped once and it is shared by many resources.
+	if (deviceObj->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		result = vkMapMemory(deviceObj->device, memory, 0, VK_WHOLE_SIZE, 0, (void **)&block->pMapped);
+		assert(result == VK_SUCCESS);
+	}
+
+	blocks.push_back(block);
+	return block;
+}
+
+bool VulkanMemoryAllocator::allocateFromBlock(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation* allocation)
+{
+	std::map<VkDeviceSize, VkDeviceSize>::iterator range;
+	for (range = block->freeRanges.begin(); range != block->freeRanges.end(); ++range) {
+		VkDeviceSize rangeOffset	= range->first;
+		VkDeviceSize rangeSize		= range->second;
+		VkDeviceSize alignedOffset	= alignUp(rangeOffset, alignment);
+
+		if (alignedOffset + size > rangeOffset + rangeSize) {
+			continue;
+		}
+
+		// Split the free range, the alignment padding and the tail remain free
+		block->freeRanges.erase(range);
+		if (alignedOffset > rangeOffset) {
+			block->freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+		}
+		if (alignedOffset + size < rangeOffset + rangeSize) {
+			block->freeRanges[alignedOffset + size] = rangeOffset + rangeSize - (alignedOffset + size);
+		}
+
+		block->allocationCount++;
+
+		allocation->memory			= block->memory;
+		allocation->offset			= alignedOffset;
+		allocation->size			= size;
+		allocation->memoryTypeIndex	= block->memoryTypeIndex;
+		allocation->pMapped			= block->pMapped ? block->pMapped + alignedOffset : NULL;
+		allocation->block			= block;
+		return true;
+	}
+
+	return false;
+}
+
+void VulkanMemoryAllocator::destroyBlock(MemoryBlock* block)
+{
+	if (block->pMapped) {
+		vkUnmapMemory(deviceObj->device, block->memory);
+	}
+	vkFreeMemory(deviceObj->device, block->memory, NULL);
+
+	blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+	delete block;
+}
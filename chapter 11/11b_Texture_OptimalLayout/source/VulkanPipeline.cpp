@@ -28,11 +28,13 @@
 #include "VulkanShader.h"
 #include "VulkanRenderer.h"
 #include "VulkanDevice.h"
+#include "Wrappers.h"
 
 VulkanPipeline::VulkanPipeline()
 {
-	appObj = VulkanApplication::GetInstance();
-	deviceObj = appObj->deviceObj;
+	appObj			= VulkanApplication::GetInstance();
+	deviceObj		= appObj->deviceObj;
+	pipelineCache	= VK_NULL_HANDLE;
 }
 
 VulkanPipeline::~VulkanPipeline()
@@ -41,19 +43,91 @@ VulkanPipeline::~VulkanPipeline()
 
 void VulkanPipeline::createPipelineCache()
 {
+	// The cache outlives the swapchain dependent objects, 
+	// keep using the existing one while resizing.
+	if (pipelineCache != VK_NULL_HANDLE) {
+		return;
+	}
+
 	VkResult  result;
 
+	// Read the cache saved by the previous run, ignore it if it was produced
+	// by another device or driver. A missing or empty file is a cache miss.
+	size_t cacheSize	= 0;
+	void* cacheData		= readFile(PIPELINE_CACHE_FILE_NAME, &cacheSize);
+	if (cacheData && !isPipelineCacheDataValid(cacheData, cacheSize)) {
+		free(cacheData);
+		cacheData = NULL;
+		cacheSize = 0;
+	}
+
 	VkPipelineCacheCreateInfo pipelineCacheInfo;
 	pipelineCacheInfo.sType				= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
 	pipelineCacheInfo.pNext				= NULL;
-	pipelineCacheInfo.initialDataSize	= 0;
-	pipelineCacheInfo.pInitialData		= NULL;
+	pipelineCacheInfo.initialDataSize	= cacheSize;
+	pipelineCacheInfo.pInitialData		= cacheData;
 	pipelineCacheInfo.flags				= 0;
 	result = vkCreatePipelineCache(deviceObj->device, &pipelineCacheInfo, NULL, &pipelineCache);
+
+	// The driver may still reject the data, start with an empty cache then
+	if (result != VK_SUCCESS && cacheData) {
+		pipelineCacheInfo.initialDataSize	= 0;
+		pipelineCacheInfo.pInitialData		= NULL;
+		result = vkCreatePipelineCache(deviceObj->device, &pipelineCacheInfo, NULL, &pipelineCache);
+	}
 	assert(result == VK_SUCCESS);
+
+	free(cacheData);
+}
+
+bool VulkanPipeline::isPipelineCacheDataValid(const void* data, size_t size)
+{
+	// Header layout for VK_PIPELINE_CACHE_HEADER_VERSION_ONE:
+	// length(4), version(4), vendorID(4), deviceID(4), pipelineCacheUUID(VK_UUID_SIZE)
+	const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+	if (size < headerSize) {
+		return false;
+	}
+
+	uint32_t header[4];
+	memcpy(header, data, sizeof(header));
+	const uint8_t* uuid = (const uint8_t*)data + sizeof(header);
+
+	return	header[0] >= headerSize && header[0] <= size &&
+			header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header[2] == deviceObj->gpuProps.vendorID &&
+			header[3] == deviceObj->gpuProps.deviceID &&
+			memcmp(uuid, deviceObj->gpuProps.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void VulkanPipeline::savePipelineCache()
+{
+	if (pipelineCache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// Query the size and then fetch the cache data
+	size_t cacheSize = 0;
+	VkResult result = vkGetPipelineCacheData(deviceObj->device, pipelineCache, &cacheSize, NULL);
+	if (result != VK_SUCCESS || cacheSize == 0) {
+		return;
+	}
+
+	std::vector<uint8_t> cacheData(cacheSize);
+	result = vkGetPipelineCacheData(deviceObj->device, pipelineCache, &cacheSize, cacheData.data());
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	writeFile(PIPELINE_CACHE_FILE_NAME, cacheData.data(), cacheSize);
 }
 
 bool VulkanPipeline::createPipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi)
+{
+	return createPipeline(drawableObj, pipeline, shaderObj->shaderStages, includeDepth, includeVi);
+}
+
+bool VulkanPipeline::createPipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, const VkPipelineShaderStageCreateInfo* shaderStages, VkBool32 includeDepth, VkBool32 includeVi)
 {
 	// Initialize the dynamic states, initially its empty
 	VkDynamicState dynamicStateEnables[2];
@@ -73,9 +147,9 @@ bool VulkanPipeline::createPipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	vertexInputStateInfo.flags							= 0;
 	if(includeVi)
 	{
-		vertexInputStateInfo.vertexBindingDescriptionCount	= sizeof(drawableObj->viIpBind) / sizeof(VkVertexInputBindingDescription);
-		vertexInputStateInfo.pVertexBindingDescriptions		= &drawableObj->viIpBind;
-		vertexInputStateInfo.vertexAttributeDescriptionCount = sizeof(drawableObj->viIpAttrb)/sizeof(VkVertexInputAttributeDescription);
+		vertexInputStateInfo.vertexBindingDescriptionCount	= drawableObj->viIpBindCount;
+		vertexInputStateInfo.pVertexBindingDescriptions		= drawableObj->viIpBind;
+		vertexInputStateInfo.vertexAttributeDescriptionCount = drawableObj->viIpAttrbCount;
 		vertexInputStateInfo.pVertexAttributeDescriptions	= drawableObj->viIpAttrb;
 	}
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
@@ -191,8 +265,8 @@ bool VulkanPipeline::createPipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	pipelineInfo.pDynamicState			= &dynamicState;
 	pipelineInfo.pViewportState			= &viewportStateInfo;
 	pipelineInfo.pDepthStencilState		= &depthStencilStateInfo;
-	pipelineInfo.pStages				= shaderObj->shaderStages;
-	pipelineInfo.stageCount				= 2;
+	pipelineInfo.pStages				= shaderStages;
+	pipelineInfo.stageCount				= SHADER_STAGE_COUNT;
 	pipelineInfo.renderPass				= appObj->rendererObj->renderPass;
 	pipelineInfo.subpass				= 0;
 
@@ -207,8 +281,247 @@ bool VulkanPipeline::createPipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	}
 }
 
+void PipelineKey::add(const void* bytes, size_t size)
+{
+	const uint8_t* byte = (const uint8_t*)bytes;
+	data.insert(data.end(), byte, byte + size);
+
+	// FNV-1a, continued over the appended bytes
+	if (hash == 0) {
+		hash = (size_t)14695981039346656037ULL;
+	}
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ byte[i]) * (size_t)1099511628211ULL;
+	}
+}
+
+PipelineKey VulkanPipeline::getPipelineKey(const PipelineDescription& description)
+{
+	PipelineKey key;
+	key.add(&description.includeDepth, sizeof(description.includeDepth));
+	key.add(&description.includeVi, sizeof(description.includeVi));
+	key.add(&description.drawableObj->pipelineLayout, sizeof(VkPipelineLayout));
+	key.add(&appObj->rendererObj->renderPass, sizeof(VkRenderPass));
+
+	// Stage, module and entry point name of the two shader stages
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		const VkPipelineShaderStageCreateInfo& stage = description.shaderObj->shaderStages[i];
+		key.add(&stage.stage, sizeof(stage.stage));
+		key.add(&stage.module, sizeof(stage.module));
+		key.add(stage.pName, strlen(stage.pName) + 1);
+
+		// The variants of a module differ by their specialization constants
+		if (stage.pSpecializationInfo) {
+			const VkSpecializationInfo* specialization = stage.pSpecializationInfo;
+			key.add(&specialization->mapEntryCount, sizeof(uint32_t));
+			key.add(specialization->pMapEntries, specialization->mapEntryCount * sizeof(VkSpecializationMapEntry));
+			key.add(specialization->pData, specialization->dataSize);
+		}
+	}
+
+	if (description.includeVi) {
+		const VulkanDrawable* drawableObj = description.drawableObj;
+		key.add(&drawableObj->viIpBindCount, sizeof(uint32_t));
+		key.add(drawableObj->viIpBind, drawableObj->viIpBindCount * sizeof(VkVertexInputBindingDescription));
+		key.add(&drawableObj->viIpAttrbCount, sizeof(uint32_t));
+		key.add(drawableObj->viIpAttrb, drawableObj->viIpAttrbCount * sizeof(VkVertexInputAttributeDescription));
+	}
+
+	return key;
+}
+
+JobHandle VulkanPipeline::createPipelines(std::vector<PipelineDescription>& descriptions)
+{
+	VulkanJobSystem* jobSystem = &appObj->jobSystem;
+
+	// Group the descriptions by state, the states already in the map are reused
+	std::vector<PipelineKey> newKeys;
+	std::vector<ShaderStagesSnapshot> newStages;
+	std::vector<std::vector<PipelineDescription*> > newDescriptions;
+	{
+		std::lock_guard<std::mutex> lock(pipelinesMutex);
+		for (uint32_t i = 0; i < descriptions.size(); i++) {
+			PipelineKey key = getPipelineKey(descriptions[i]);
+			std::unordered_map<PipelineKey, SharedPipeline, PipelineKeyHasher>::iterator found = pipelines.find(key);
+			if (found != pipelines.end()) {
+				found->second.refCount++;
+				descriptions[i].pipeline = found->second.pipeline;
+				continue;
+			}
+
+			std::vector<PipelineKey>::iterator newKey = std::find(newKeys.begin(), newKeys.end(), key);
+			if (newKey == newKeys.end()) {
+				newKeys.push_back(key);
+				newStages.push_back(descriptions[i].shaderObj->getStagesSnapshot());
+				newDescriptions.push_back(std::vector<PipelineDescription*>());
+				newKey = newKeys.end() - 1;
+			}
+			newDescriptions[newKey - newKeys.begin()].push_back(&descriptions[i]);
+		}
+	}
+
+	// Compile the distinct states only. The pipeline cache is internally synchronized, 
+	// the jobs share it and benefit from the cache data loaded from the disk.
+	JobHandle batch = jobSystem->createJob([] {});
+	for (uint32_t i = 0; i < newKeys.size(); i++) {
+		PipelineKey key = newKeys[i];
+		ShaderStagesSnapshot shader = newStages[i];
+		std::vector<PipelineDescription*> users = newDescriptions[i];
+		jobSystem->schedule([this, key, shader, users] {
+			PipelineDescription* description = users[0];
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			if (!createPipeline(description->drawableObj, &pipeline, shader.stages,
+				description->includeDepth, description->includeVi)) {
+				pipeline = VK_NULL_HANDLE;
+			}
+
+			// A failed state is not kept, the next request retries it
+			if (pipeline != VK_NULL_HANDLE) {
+				std::lock_guard<std::mutex> lock(pipelinesMutex);
+				std::unordered_map<PipelineKey, SharedPipeline, PipelineKeyHasher>::iterator found = pipelines.find(key);
+				if (found != pipelines.end()) {
+					// Another batch in flight compiled the same state first, share its pipeline
+					vkDestroyPipeline(deviceObj->device, pipeline, NULL);
+					pipeline = found->second.pipeline;
+					found->second.refCount += (uint32_t)users.size();
+				}
+				else {
+					SharedPipeline& shared	= pipelines[key];
+					shared.pipeline			= pipeline;
+					shared.refCount			= (uint32_t)users.size();
+					pipelineKeys[pipeline]	= key;
+				}
+			}
+
+			for each (PipelineDescription* user in users)
+			{
+				user->pipeline = pipeline;
+			}
+		}, batch);
+	}
+	jobSystem->run(batch);
+
+	return batch;
+}
+
+void VulkanPipeline::releasePipeline(VkPipeline pipeline)
+{
+	std::lock_guard<std::mutex> lock(pipelinesMutex);
+	std::unordered_map<VkPipeline, PipelineKey>::iterator key = pipelineKeys.find(pipeline);
+	assert(key != pipelineKeys.end());
+	std::unordered_map<PipelineKey, SharedPipeline, PipelineKeyHasher>::iterator shared = pipelines.find(key->second);
+	assert(shared != pipelines.end());
+
+	if (--shared->second.refCount == 0) {
+		vkDestroyPipeline(deviceObj->device, pipeline, NULL);
+		pipelines.erase(shared);
+		pipelineKeys.erase(key);
+	}
+}
+
+VkDescriptorSetLayout VulkanPipeline::acquireDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& layoutBindings)
+{
+	PipelineKey key;
+	for each (const VkDescriptorSetLayoutBinding& binding in layoutBindings)
+	{
+		key.add(&binding.binding, sizeof(binding.binding));
+		key.add(&binding.descriptorType, sizeof(binding.descriptorType));
+		key.add(&binding.descriptorCount, sizeof(binding.descriptorCount));
+		key.add(&binding.stageFlags, sizeof(binding.stageFlags));
+		assert(binding.pImmutableSamplers == NULL);
+	}
+
+	std::lock_guard<std::mutex> lock(pipelinesMutex);
+	std::unordered_map<PipelineKey, SharedDescriptorSetLayout, PipelineKeyHasher>::iterator found = descriptorSetLayouts.find(key);
+	if (found != descriptorSetLayouts.end()) {
+		found->second.refCount++;
+		return found->second.layout;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = {};
+	descriptorLayout.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorLayout.pNext			= NULL;
+	descriptorLayout.bindingCount	= (uint32_t)layoutBindings.size();
+	descriptorLayout.pBindings		= layoutBindings.data();
+
+	SharedDescriptorSetLayout shared;
+	shared.refCount = 1;
+	VkResult result = vkCreateDescriptorSetLayout(deviceObj->device, &descriptorLayout, NULL, &shared.layout);
+	assert(result == VK_SUCCESS);
+
+	descriptorSetLayouts[key] = shared;
+	return shared.layout;
+}
+
+void VulkanPipeline::releaseDescriptorSetLayout(VkDescriptorSetLayout layout)
+{
+	std::lock_guard<std::mutex> lock(pipelinesMutex);
+	std::unordered_map<PipelineKey, SharedDescriptorSetLayout, PipelineKeyHasher>::iterator shared = descriptorSetLayouts.begin();
+	while (shared != descriptorSetLayouts.end() && shared->second.layout != layout) {
+		shared++;
+	}
+	assert(shared != descriptorSetLayouts.end());
+
+	if (--shared->second.refCount == 0) {
+		vkDestroyDescriptorSetLayout(deviceObj->device, layout, NULL);
+		descriptorSetLayouts.erase(shared);
+	}
+}
+
+VkPipelineLayout VulkanPipeline::acquirePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	PipelineKey key;
+	uint32_t setLayoutCount = (uint32_t)setLayouts.size();
+	key.add(&setLayoutCount, sizeof(setLayoutCount));
+	key.add(setLayouts.data(), setLayouts.size() * sizeof(VkDescriptorSetLayout));
+	key.add(pushConstantRanges.data(), pushConstantRanges.size() * sizeof(VkPushConstantRange));
+
+	std::lock_guard<std::mutex> lock(pipelinesMutex);
+	std::unordered_map<PipelineKey, SharedPipelineLayout, PipelineKeyHasher>::iterator found = pipelineLayouts.find(key);
+	if (found != pipelineLayouts.end()) {
+		found->second.refCount++;
+		return found->second.layout;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext					= NULL;
+	pipelineLayoutCreateInfo.pushConstantRangeCount	= (uint32_t)pushConstantRanges.size();
+	pipelineLayoutCreateInfo.pPushConstantRanges	= pushConstantRanges.data();
+	pipelineLayoutCreateInfo.setLayoutCount			= setLayoutCount;
+	pipelineLayoutCreateInfo.pSetLayouts			= setLayouts.data();
+
+	SharedPipelineLayout shared;
+	shared.refCount = 1;
+	VkResult result = vkCreatePipelineLayout(deviceObj->device, &pipelineLayoutCreateInfo, NULL, &shared.layout);
+	assert(result == VK_SUCCESS);
+
+	pipelineLayouts[key] = shared;
+	return shared.layout;
+}
+
+void VulkanPipeline::releasePipelineLayout(VkPipelineLayout layout)
+{
+	std::lock_guard<std::mutex> lock(pipelinesMutex);
+	std::unordered_map<PipelineKey, SharedPipelineLayout, PipelineKeyHasher>::iterator shared = pipelineLayouts.begin();
+	while (shared != pipelineLayouts.end() && shared->second.layout != layout) {
+		shared++;
+	}
+	assert(shared != pipelineLayouts.end());
+
+	if (--shared->second.refCount == 0) {
+		vkDestroyPipelineLayout(deviceObj->device, layout, NULL);
+		pipelineLayouts.erase(shared);
+	}
+}
+
 // Destroy the pipeline cache object when no more required
 void VulkanPipeline::destroyPipelineCache()
 {
+	// Every pipeline is expected to be released already
+	assert(pipelines.empty());
+
+	savePipelineCache();
 	vkDestroyPipelineCache(deviceObj->device, pipelineCache, NULL);
+	pipelineCache = VK_NULL_HANDLE;
 }
@@ -0,0 +1,357 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanProfiler.h"
+#include "VulkanApplication.h"
+#include "VulkanDevice.h"
+
+VulkanProfiler::VulkanProfiler()
+{
+	deviceObj			= VulkanApplication::GetInstance()->deviceObj;
+	supported			= false;
+	timestampMask		= 0;
+	nanosecondsPerTick	= 1.0;
+	currentSlot			= NULL;
+	setupSlot.pool		= VK_NULL_HANDLE;
+	setupSlot.queryCount= 0;
+	setupSlot.reset		= false;
+	setupSlot.pending	= false;
+	uploadSlot.pool		= VK_NULL_HANDLE;
+	uploadSlot.queryCount= 0;
+	uploadSlot.reset	= false;
+	uploadSlot.pending	= false;
+}
+
+VulkanProfiler::~VulkanProfiler()
+{
+}
+
+void VulkanProfiler::create(uint32_t frameCount)
+{
+	if (currentSlot) {
+		return;
+	}
+
+	// Timestamps are supported only if the queue family has valid bits
+	uint32_t validBits = deviceObj->queueFamilyProps[deviceObj->graphicsQueueWithPresentIndex].timestampValidBits;
+	supported			= validBits > 0;
+	timestampMask		= validBits >= 64 ? UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+
+	// Number of nanoseconds for a timestamp to be incremented by 1
+	nanosecondsPerTick	= deviceObj->gpuProps.limits.timestampPeriod;
+
+	frameSlots.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++) {
+		createSlot(&frameSlots[i]);
+	}
+	createSlot(&setupSlot);
+	createSlot(&uploadSlot);
+
+	// Scopes go into the setup slot until the first frame begins
+	currentSlot = &setupSlot;
+}
+
+void VulkanProfiler::createSlot(QuerySlot* slot)
+{
+	slot->pool			= VK_NULL_HANDLE;
+	slot->queryCount	= 0;
+	slot->reset			= false;
+	slot->pending		= false;
+	slot->names.clear();
+
+	if (!supported) {
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType					= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.pNext					= NULL;
+	queryPoolInfo.flags					= 0;
+	queryPoolInfo.queryType				= VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount			= PROFILER_MAX_QUERIES;
+	queryPoolInfo.pipelineStatistics	= 0;
+
+	VkResult result = vkCreateQueryPool(deviceObj->device, &queryPoolInfo, NULL, &slot->pool);
+	assert(result == VK_SUCCESS);
+}
+
+void VulkanProfiler::destroySlot(QuerySlot* slot)
+{
+	if (slot->pool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(deviceObj->device, slot->pool, NULL);
+		slot->pool = VK_NULL_HANDLE;
+	}
+}
+
+void VulkanProfiler::destroy()
+{
+	for (uint32_t i = 0; i < frameSlots.size(); i++) {
+		destroySlot(&frameSlots[i]);
+	}
+	frameSlots.clear();
+
+	destroySlot(&setupSlot);
+	destroySlot(&uploadSlot);
+	currentSlot = NULL;
+}
+
+void VulkanProfiler::beginFrame(uint32_t frameIndex, VkCommandBuffer cmd)
+{
+	if (!supported) {
+		return;
+	}
+
+	// The setup scopes complete in queue order, poll them 
+	// without waiting until all of them are available.
+	if (setupSlot.pending) {
+		readback(&setupSlot, false);
+	}
+	pollUploadSlot(false);
+
+	// The frame fence is signaled, the results of the 
+	// previous use of this slot are available.
+	QuerySlot* slot = &frameSlots[frameIndex];
+	if (slot->pending) {
+		readback(slot, true);
+	}
+
+	vkCmdResetQueryPool(cmd, slot->pool, 0, PROFILER_MAX_QUERIES);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	slot->queryCount	= 0;
+	slot->reset			= true;
+	slot->names.clear();
+	currentSlot			= slot;
+}
+
+uint32_t VulkanProfiler::beginScope(VkCommandBuffer cmd, const char* name)
+{
+	if (!supported || !currentSlot) {
+		return PROFILER_INVALID_SCOPE;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return beginScope(currentSlot, cmd, name);
+}
+
+uint32_t VulkanProfiler::beginUploadScope(VkCommandBuffer cmd, const char* name)
+{
+	if (!supported || !currentSlot) {
+		return PROFILER_INVALID_SCOPE;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return beginScope(&uploadSlot, cmd, name);
+}
+
+uint32_t VulkanProfiler::beginScope(QuerySlot* slot, VkCommandBuffer cmd, const char* name)
+{
+	// The setup and upload slots are reset in the first command buffer writing 
+	// into them, their scopes are recorded outside of render pass instances.
+	if (!slot->reset) {
+		vkCmdResetQueryPool(cmd, slot->pool, 0, PROFILER_MAX_QUERIES);
+		slot->reset = true;
+	}
+
+	// Out of queries, the scope is dropped
+	if (slot->queryCount + 2 > PROFILER_MAX_QUERIES) {
+		return PROFILER_INVALID_SCOPE;
+	}
+
+	uint32_t scope = slot->queryCount;
+	slot->queryCount += 2;
+	slot->names.push_back(name);
+	slot->pending = true;
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot->pool, scope);
+
+	// Encode the slot with the query index, the end timestamp 
+	// goes into the same pool even if a new frame began since.
+	uint32_t slotIndex = (uint32_t)frameSlots.size();
+	if (slot == &uploadSlot) {
+		slotIndex = (uint32_t)frameSlots.size() + 1;
+	}
+	else if (slot != &setupSlot) {
+		slotIndex = (uint32_t)(slot - frameSlots.data());
+	}
+	return slotIndex * PROFILER_MAX_QUERIES + scope;
+}
+
+VulkanProfiler::QuerySlot* VulkanProfiler::getSlot(uint32_t slotIndex)
+{
+	if (slotIndex == frameSlots.size()) {
+		return &setupSlot;
+	}
+	if (slotIndex == frameSlots.size() + 1) {
+		return &uploadSlot;
+	}
+	return &frameSlots[slotIndex];
+}
+
+void VulkanProfiler::endScope(VkCommandBuffer cmd, uint32_t scope)
+{
+	if (scope == PROFILER_INVALID_SCOPE) {
+		return;
+	}
+
+	uint32_t slotIndex	= scope / PROFILER_MAX_QUERIES;
+	uint32_t query		= scope % PROFILER_MAX_QUERIES;
+	QuerySlot* slot		= getSlot(slotIndex);
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot->pool, query + 1);
+}
+
+bool VulkanProfiler::readback(QuerySlot* slot, bool wait)
+{
+	if (slot->queryCount == 0) {
+		slot->pending = false;
+		return true;
+	}
+
+	// Without the wait flag the call returns VK_NOT_READY 
+	// if any of the queries is not yet available.
+	std::vector<uint64_t> timestamps(slot->queryCount);
+	VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | (wait ? VK_QUERY_RESULT_WAIT_BIT : 0);
+	VkResult result = vkGetQueryPoolResults(deviceObj->device, slot->pool, 0, slot->queryCount,
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), flags);
+	if (result != VK_SUCCESS) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < slot->names.size(); i++) {
+		uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & timestampMask;
+		addSample(slot->names[i], ticks * nanosecondsPerTick / 1000000.0);
+	}
+
+	slot->pending = false;
+	return true;
+}
+
+void VulkanProfiler::pollUploadSlot(bool wait)
+{
+	// The upload scopes are recorded while the slot is read back
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!uploadSlot.pending || !readback(&uploadSlot, wait)) {
+		return;
+	}
+
+	// All the results are collected, the next upload scope resets the pool
+	uploadSlot.queryCount	= 0;
+	uploadSlot.reset		= false;
+	uploadSlot.names.clear();
+}
+
+void VulkanProfiler::flush()
+{
+	if (!supported) {
+		return;
+	}
+
+	if (setupSlot.pending) {
+		readback(&setupSlot, true);
+	}
+	pollUploadSlot(true);
+
+	for (uint32_t i = 0; i < frameSlots.size(); i++) {
+		if (frameSlots[i].pending) {
+			readback(&frameSlots[i], true);
+		}
+	}
+}
+
+void VulkanProfiler::addSample(const std::string& name, double milliseconds)
+{
+	ScopeStats& scopeStats = stats[name];
+	if (scopeStats.samples.empty()) {
+		scopeStats.samples.reserve(PROFILER_HISTORY_SIZE);
+		scopeStats.next		= 0;
+		scopeStats.count	= 0;
+	}
+
+	// Overwrite the oldest sample once the history is full
+	if (scopeStats.samples.size() < PROFILER_HISTORY_SIZE) {
+		scopeStats.samples.push_back(milliseconds);
+	}
+	else {
+		scopeStats.samples[scopeStats.next] = milliseconds;
+	}
+	scopeStats.next = (scopeStats.next + 1) % PROFILER_HISTORY_SIZE;
+	scopeStats.count++;
+}
+
+void VulkanProfiler::computeStats(const ScopeStats& scopeStats, double* average, double* minimum, double* maximum, double* last)
+{
+	double sum	= 0.0;
+	*minimum	= scopeStats.samples[0];
+	*maximum	= scopeStats.samples[0];
+	for each (double sample in scopeStats.samples)
+	{
+		sum += sample;
+		*minimum = std::min(*minimum, sample);
+		*maximum = std::max(*maximum, sample);
+	}
+	*average	= sum / scopeStats.samples.size();
+	*last		= scopeStats.samples[(scopeStats.next + PROFILER_HISTORY_SIZE - 1) % PROFILER_HISTORY_SIZE];
+}
+
+bool VulkanProfiler::exportJSON(const char* fileName)
+{
+	FILE* fp = fopen(fileName, "w");
+	if (!fp) {
+		return false;
+	}
+
+	fprintf(fp, "{\n\t\"unit\": \"ms\",\n\t\"scopes\": [");
+	bool first = true;
+	for each (auto& scope in stats)
+	{
+		double average, minimum, maximum, last;
+		computeStats(scope.second, &average, &minimum, &maximum, &last);
+		fprintf(fp, "%s\n\t\t{ \"name\": \"%s\", \"count\": %llu, \"last\": %f, \"average\": %f, \"min\": %f, \"max\": %f }",
+			first ? "" : ",", scope.first.c_str(), (unsigned long long)scope.second.count, last, average, minimum, maximum);
+		first = false;
+	}
+	fprintf(fp, "\n\t]\n}\n");
+
+	return fclose(fp) == 0;
+}
+
+bool VulkanProfiler::exportCSV(const char* fileName)
+{
+	FILE* fp = fopen(fileName, "w");
+	if (!fp) {
+		return false;
+	}
+
+	fprintf(fp, "name,count,last_ms,average_ms,min_ms,max_ms\n");
+	for each (auto& scope in stats)
+	{
+		double average, minimum, maximum, last;
+		computeStats(scope.second, &average, &minimum, &maximum, &last);
+		fprintf(fp, "%s,%llu,%f,%f,%f,%f\n", scope.first.c_str(), (unsigned long long)scope.second.count, last, average, minimum, maximum);
+	}
+
+	return fclose(fp) == 0;
+}
@@ -0,0 +1,469 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanRenderGraph.h"
+#include "VulkanResourceTracker.h"
+#include "VulkanApplication.h"
+#include "VulkanDevice.h"
+
+VulkanRenderGraph::VulkanRenderGraph()
+{
+	deviceObj	= VulkanApplication::GetInstance()->deviceObj;
+	tracker		= NULL;
+	compiled	= false;
+}
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+}
+
+void VulkanRenderGraph::begin(VulkanResourceTracker* resourceTracker)
+{
+	destroy();
+	tracker = resourceTracker;
+}
+
+uint32_t VulkanRenderGraph::importImage(const char* name, VkImageAspectFlags aspectMask)
+{
+	Resource resource;
+	memset(&resource.imageInfo, 0, sizeof(resource.imageInfo));
+	resource.name			= name;
+	resource.transient		= false;
+	resource.output			= false;
+	resource.image			= VK_NULL_HANDLE;
+	resource.view			= VK_NULL_HANDLE;
+	resource.aspectMask		= aspectMask;
+	resource.firstPass		= RENDER_GRAPH_INVALID_INDEX;
+	resource.lastPass		= RENDER_GRAPH_INVALID_INDEX;
+	resource.memoryIndex	= RENDER_GRAPH_INVALID_INDEX;
+
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+void VulkanRenderGraph::setImportedImage(uint32_t resource, VkImage image, VkImageView view)
+{
+	assert(!resources[resource].transient);
+	resources[resource].image	= image;
+	resources[resource].view	= view;
+
+	// The images of the swapchain are not known by the tracker
+	if (!tracker->isRegistered(image)) {
+		tracker->registerImage(image, 1, 1);
+		registeredImages.push_back(image);
+	}
+}
+
+uint32_t VulkanRenderGraph::createTransientImage(const char* name, VkFormat format, uint32_t width, uint32_t height,
+	VkImageUsageFlags usage, VkImageAspectFlags aspectMask)
+{
+	uint32_t index = importImage(name, aspectMask);
+	Resource& resource = resources[index];
+	resource.transient = true;
+
+	VkImageCreateInfo& imageInfo	= resource.imageInfo;
+	imageInfo.sType					= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.pNext					= NULL;
+	imageInfo.imageType				= VK_IMAGE_TYPE_2D;
+	imageInfo.format				= format;
+	imageInfo.extent.width			= width;
+	imageInfo.extent.height			= height;
+	imageInfo.extent.depth			= 1;
+	imageInfo.mipLevels				= 1;
+	imageInfo.arrayLayers			= 1;
+	imageInfo.samples				= VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling				= VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage					= usage;
+	if (!(usage & ~TRANSIENT_ATTACHMENT_USAGE_MASK)) {
+		imageInfo.usage				|= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+	imageInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.queueFamilyIndexCount	= 0;
+	imageInfo.pQueueFamilyIndices	= NULL;
+	imageInfo.initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.flags					= 0;
+
+	return index;
+}
+
+uint32_t VulkanRenderGraph::addPass(const char* name, RecordFunction record)
+{
+	Pass pass;
+	pass.name	= name;
+	pass.record	= record;
+	pass.culled	= false;
+
+	passes.push_back(pass);
+	return (uint32_t)passes.size() - 1;
+}
+
+void VulkanRenderGraph::addUse(uint32_t pass, uint32_t resource, bool write, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkImageLayout finalLayout)
+{
+	// Only the imported images keep their content out of the graph
+	assert(layout != VK_IMAGE_LAYOUT_UNDEFINED || !resources[resource].transient);
+
+	ResourceUse use;
+	use.resource	= resource;
+	use.write		= write;
+	use.layout		= layout;
+	use.finalLayout	= (finalLayout == VK_IMAGE_LAYOUT_UNDEFINED) ? layout : finalLayout;
+	use.stageMask	= stageMask;
+	use.accessMask	= accessMask;
+
+	passes[pass].uses.push_back(use);
+}
+
+void VulkanRenderGraph::readImage(uint32_t pass, uint32_t resource, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask,
+	VkImageLayout finalLayout)
+{
+	addUse(pass, resource, false, layout, stageMask, accessMask, finalLayout);
+}
+
+void VulkanRenderGraph::writeImage(uint32_t pass, uint32_t resource, VkImageLayout layout, VkPipelineStageFlags stageMask, VkAccessFlags accessMask,
+	VkImageLayout finalLayout)
+{
+	addUse(pass, resource, true, layout, stageMask, accessMask, finalLayout);
+}
+
+void VulkanRenderGraph::markOutput(uint32_t resource)
+{
+	resources[resource].output = true;
+}
+
+void VulkanRenderGraph::compile()
+{
+	assert(tracker != NULL);
+
+	sortPasses();
+	cullPasses();
+	createTransientImages();
+
+	compiled = true;
+}
+
+void VulkanRenderGraph::sortPasses()
+{
+	// Dependencies between the passes, derived from the declaration order of the uses
+	// of each resource. A read depends on the last writer declared before it, or on 
+	// all the writers if none was declared before. A write depends on the previous 
+	// uses whose content came from an earlier writer.
+	std::vector<std::vector<uint32_t> >	successors(passes.size());
+	std::vector<uint32_t>				dependencyCount(passes.size(), 0);
+
+	for (uint32_t resource = 0; resource < resources.size(); resource++) {
+		std::vector<uint32_t> writers;
+		for (uint32_t p = 0; p < passes.size(); p++) {
+			for each (const ResourceUse& use in passes[p].uses) {
+				if (use.resource == resource && use.write) {
+					writers.push_back(p);
+					break;
+				}
+			}
+		}
+
+		uint32_t lastWriter = RENDER_GRAPH_INVALID_INDEX;
+		std::vector<uint32_t> orderedUsers;			// Passes using the content of an earlier writer
+		for (uint32_t p = 0; p < passes.size(); p++) {
+			bool reads = false, writes = false;
+			for each (const ResourceUse& use in passes[p].uses) {
+				if (use.resource == resource) {
+					reads	= reads || !use.write;
+					writes	= writes || use.write;
+				}
+			}
+
+			std::vector<uint32_t> dependencies;
+			if (reads && lastWriter == RENDER_GRAPH_INVALID_INDEX) {
+				dependencies = writers;
+			}
+			if (writes || lastWriter != RENDER_GRAPH_INVALID_INDEX) {
+				dependencies.insert(dependencies.end(), orderedUsers.begin(), orderedUsers.end());
+			}
+
+			for each (uint32_t dependency in dependencies) {
+				if (dependency != p && std::find(successors[dependency].begin(), successors[dependency].end(), p) == successors[dependency].end()) {
+					successors[dependency].push_back(p);
+					dependencyCount[p]++;
+				}
+			}
+
+			if (writes) {
+				lastWriter = p;
+				orderedUsers.clear();
+				orderedUsers.push_back(p);
+			}
+			else if (reads && lastWriter != RENDER_GRAPH_INVALID_INDEX) {
+				orderedUsers.push_back(p);
+			}
+		}
+	}
+
+	// Topological order, the ready pass declared first goes first
+	executionOrder.clear();
+	std::vector<bool> done(passes.size(), false);
+	while (executionOrder.size() < passes.size()) {
+		uint32_t next = RENDER_GRAPH_INVALID_INDEX;
+		for (uint32_t p = 0; p < passes.size(); p++) {
+			if (!done[p] && dependencyCount[p] == 0) {
+				next = p;
+				break;
+			}
+		}
+
+		// A cycle between the passes can't be ordered
+		assert(next != RENDER_GRAPH_INVALID_INDEX);
+
+		done[next] = true;
+		executionOrder.push_back(next);
+		for each (uint32_t successor in successors[next]) {
+			dependencyCount[successor]--;
+		}
+	}
+}
+
+void VulkanRenderGraph::cullPasses()
+{
+	// Walk the passes backward, a pass is kept if it writes an output or an 
+	// image read by a kept pass executed later. Outputs and reads are then 
+	// considered as needed by the earlier passes.
+	std::vector<bool> needed(resources.size(), false);
+	for (uint32_t resource = 0; resource < resources.size(); resource++) {
+		needed[resource] = resources[resource].output;
+	}
+
+	for (int i = (int)executionOrder.size() - 1; i >= 0; i--) {
+		Pass& pass	= passes[executionOrder[i]];
+		pass.culled	= true;
+		for each (const ResourceUse& use in pass.uses) {
+			if (use.write && needed[use.resource]) {
+				pass.culled = false;
+			}
+		}
+
+		if (!pass.culled) {
+			for each (const ResourceUse& use in pass.uses) {
+				if (!use.write) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+
+	// Keep the passes to execute only
+	std::vector<uint32_t> liveOrder;
+	for each (uint32_t p in executionOrder) {
+		if (!passes[p].culled) {
+			liveOrder.push_back(p);
+		}
+	}
+	executionOrder = liveOrder;
+}
+
+void VulkanRenderGraph::createTransientImages()
+{
+	VkResult	result;
+	bool		pass;
+
+	// Lifetime of each transient image in the execution order
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < executionOrder.size(); i++) {
+		for each (const ResourceUse& use in passes[executionOrder[i]].uses) {
+			Resource& resource = resources[use.resource];
+			if (!resource.transient) {
+				continue;
+			}
+			if (resource.firstPass == RENDER_GRAPH_INVALID_INDEX) {
+				resource.firstPass = i;
+				transients.push_back(use.resource);
+			}
+			resource.lastPass = i;
+		}
+	}
+
+	// The images of the culled passes only are never created
+	std::vector<VkMemoryRequirements> requirements(resources.size());
+	for each (uint32_t index in transients) {
+		Resource& resource = resources[index];
+		result = vkCreateImage(deviceObj->device, &resource.imageInfo, NULL, &resource.image);
+		assert(result == VK_SUCCESS);
+		vkGetImageMemoryRequirements(deviceObj->device, resource.image, &requirements[index]);
+	}
+
+	// Place the biggest images first, an image shares the memory 
+	// of images whose lifetimes don't overlap with its own.
+	std::sort(transients.begin(), transients.end(), [&requirements](uint32_t a, uint32_t b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	for each (uint32_t index in transients) {
+		Resource& resource				= resources[index];
+		const VkMemoryRequirements& req	= requirements[index];
+
+		bool transient = (resource.imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+
+		// Lazily allocated memory is for the transient attachments only
+		for (uint32_t m = 0; m < memories.size() && resource.memoryIndex == RENDER_GRAPH_INVALID_INDEX; m++) {
+			AliasedMemory& memory = memories[m];
+			bool fits = (memory.requirements.memoryTypeBits & req.memoryTypeBits) != 0 && memory.transient == transient;
+			for each (uint32_t other in memory.resources) {
+				fits = fits && (resources[other].lastPass < resource.firstPass || resource.lastPass < resources[other].firstPass);
+			}
+
+			if (fits) {
+				memory.requirements.size			= std::max(memory.requirements.size, req.size);
+				memory.requirements.alignment		= std::max(memory.requirements.alignment, req.alignment);
+				memory.requirements.memoryTypeBits	&= req.memoryTypeBits;
+				memory.resources.push_back(index);
+				resource.memoryIndex = m;
+			}
+		}
+
+		if (resource.memoryIndex == RENDER_GRAPH_INVALID_INDEX) {
+			AliasedMemory memory;
+			memset(&memory.allocation, 0, sizeof(memory.allocation));
+			memory.requirements		= req;
+			memory.transient		= transient;
+			memory.lastStageMask	= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			memory.lastAccessMask	= 0;
+			memory.resources.push_back(index);
+			memories.push_back(memory);
+			resource.memoryIndex = (uint32_t)memories.size() - 1;
+		}
+	}
+
+	// Allocate the shared memory and bind all its images at the same offset
+	for (uint32_t m = 0; m < memories.size(); m++) {
+		AliasedMemory& memory = memories[m];
+		if (memory.transient) {
+			pass = deviceObj->memoryAllocator->allocateTransient(memory.requirements, &memory.allocation);
+		}
+		else {
+			pass = deviceObj->memoryAllocator->allocate(memory.requirements, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, &memory.allocation);
+		}
+		assert(pass);
+
+		for each (uint32_t index in memory.resources) {
+			Resource& resource = resources[index];
+			result = vkBindImageMemory(deviceObj->device, resource.image, memory.allocation.memory, memory.allocation.offset);
+			assert(result == VK_SUCCESS);
+
+			VkImageViewCreateInfo imgViewInfo = {};
+			imgViewInfo.sType							= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			imgViewInfo.pNext							= NULL;
+			imgViewInfo.image							= resource.image;
+			imgViewInfo.viewType						= VK_IMAGE_VIEW_TYPE_2D;
+			imgViewInfo.format							= resource.imageInfo.format;
+			imgViewInfo.components						= { VK_COMPONENT_SWIZZLE_IDENTITY };
+			imgViewInfo.subresourceRange.aspectMask		= resource.aspectMask;
+			imgViewInfo.subresourceRange.baseMipLevel	= 0;
+			imgViewInfo.subresourceRange.levelCount		= 1;
+			imgViewInfo.subresourceRange.baseArrayLayer	= 0;
+			imgViewInfo.subresourceRange.layerCount		= 1;
+			imgViewInfo.flags							= 0;
+
+			result = vkCreateImageView(deviceObj->device, &imgViewInfo, NULL, &resource.view);
+			assert(result == VK_SUCCESS);
+
+			tracker->registerImage(resource.image, 1, 1);
+		}
+	}
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer cmd)
+{
+	assert(compiled);
+
+	for (uint32_t i = 0; i < executionOrder.size(); i++) {
+		Pass& pass = passes[executionOrder[i]];
+
+		// Transition the images used by the pass, all in one barrier
+		VulkanBarrierBuilder barriers;
+		for each (const ResourceUse& use in pass.uses) {
+			Resource& resource = resources[use.resource];
+			VkImageSubresourceRange subresourceRange = { resource.aspectMask, 0, 1, 0, 1 };
+
+			// The content of an aliased image is undefined at its first use, wait for 
+			// the last use of the memory by the previous image living in it.
+			if (resource.transient && resource.firstPass == i) {
+				AliasedMemory& memory = memories[resource.memoryIndex];
+				tracker->setImageState(resource.image, subresourceRange, VK_IMAGE_LAYOUT_UNDEFINED, memory.lastStageMask, memory.lastAccessMask);
+			}
+
+			if (use.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+				tracker->useImage(barriers, resource.image, subresourceRange, use.layout, use.stageMask, use.accessMask);
+			}
+		}
+		barriers.flush(cmd);
+
+		pass.record(cmd);
+
+		// Layouts left by the pass, by its render pass final layouts
+		for each (const ResourceUse& use in pass.uses) {
+			Resource& resource = resources[use.resource];
+			VkImageSubresourceRange subresourceRange = { resource.aspectMask, 0, 1, 0, 1 };
+
+			if (use.finalLayout != use.layout || use.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+				tracker->setImageState(resource.image, subresourceRange, use.finalLayout, use.stageMask, use.accessMask);
+			}
+
+			if (resource.transient && resource.lastPass == i) {
+				AliasedMemory& memory	= memories[resource.memoryIndex];
+				memory.lastStageMask	= use.stageMask;
+				memory.lastAccessMask	= use.accessMask;
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::destroy()
+{
+	for (uint32_t i = 0; i < resources.size(); i++) {
+		Resource& resource = resources[i];
+		if (!resource.transient || resource.image == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		tracker->unregisterImage(resource.image);
+		if (resource.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(deviceObj->device, resource.view, NULL);
+		}
+		vkDestroyImage(deviceObj->device, resource.image, NULL);
+	}
+
+	for (uint32_t m = 0; m < memories.size(); m++) {
+		deviceObj->memoryAllocator->free(&memories[m].allocation);
+	}
+
+	for each (VkImage image in registeredImages) {
+		tracker->unregisterImage(image);
+	}
+
+	resources.clear();
+	passes.clear();
+	executionOrder.clear();
+	memories.clear();
+	registeredImages.clear();
+	compiled = false;
+}
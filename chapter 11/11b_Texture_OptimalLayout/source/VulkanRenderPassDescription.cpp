@@ -0,0 +1,132 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanRenderPassDescription.h"
+
+VulkanRenderPassDescription::VulkanRenderPassDescription()
+{
+	memset(&depthReference, 0, sizeof(depthReference));
+	hasDepth = false;
+}
+
+VulkanRenderPassDescription::~VulkanRenderPassDescription()
+{
+}
+
+uint32_t VulkanRenderPassDescription::addColorAttachment(VkFormat format, VkSampleCountFlagBits samples, VkAttachmentLoadOp loadOp,
+	VkAttachmentStoreOp storeOp, VkImageLayout finalLayout)
+{
+	VkAttachmentDescription attachment	= {};
+	attachment.format					= format;
+	attachment.samples					= samples;
+	attachment.loadOp					= loadOp;
+	attachment.storeOp					= storeOp;
+	attachment.stencilLoadOp			= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachment.stencilStoreOp			= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// Previous content is only kept when it is loaded
+	attachment.initialLayout			= (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	attachment.finalLayout				= finalLayout;
+	attachment.flags					= 0;
+
+	VkAttachmentReference reference		= {};
+	reference.attachment				= (uint32_t)attachments.size();
+	reference.layout					= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	attachments.push_back(attachment);
+	colorReferences.push_back(reference);
+	return reference.attachment;
+}
+
+uint32_t VulkanRenderPassDescription::addDepthStencilAttachment(VkFormat format, VkSampleCountFlagBits samples, VkAttachmentLoadOp loadOp,
+	VkAttachmentStoreOp storeOp, VkAttachmentLoadOp stencilLoadOp, VkAttachmentStoreOp stencilStoreOp)
+{
+	assert(!hasDepth);
+
+	bool loaded = (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) || (stencilLoadOp == VK_ATTACHMENT_LOAD_OP_LOAD);
+
+	VkAttachmentDescription attachment	= {};
+	attachment.format					= format;
+	attachment.samples					= samples;
+	attachment.loadOp					= loadOp;
+	attachment.storeOp					= storeOp;
+	attachment.stencilLoadOp			= stencilLoadOp;
+	attachment.stencilStoreOp			= stencilStoreOp;
+	attachment.initialLayout			= loaded ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	attachment.finalLayout				= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	attachment.flags					= 0;
+
+	depthReference.attachment			= (uint32_t)attachments.size();
+	depthReference.layout				= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	hasDepth							= true;
+
+	attachments.push_back(attachment);
+	return depthReference.attachment;
+}
+
+void VulkanRenderPassDescription::addDependency(uint32_t srcSubpass, uint32_t dstSubpass, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask,
+	VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+{
+	VkSubpassDependency dependency	= {};
+	dependency.srcSubpass			= srcSubpass;
+	dependency.dstSubpass			= dstSubpass;
+	dependency.srcStageMask			= srcStageMask;
+	dependency.dstStageMask			= dstStageMask;
+	dependency.srcAccessMask		= srcAccessMask;
+	dependency.dstAccessMask		= dstAccessMask;
+	dependency.dependencyFlags		= 0;
+
+	dependencies.push_back(dependency);
+}
+
+VkRenderPass VulkanRenderPassDescription::create(VkDevice device)
+{
+	VkSubpassDescription subpass			= {};
+	subpass.pipelineBindPoint				= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.flags							= 0;
+	subpass.inputAttachmentCount			= 0;
+	subpass.pInputAttachments				= NULL;
+	subpass.colorAttachmentCount			= (uint32_t)colorReferences.size();
+	subpass.pColorAttachments				= colorReferences.data();
+	subpass.pResolveAttachments				= NULL;
+	subpass.pDepthStencilAttachment			= hasDepth ? &depthReference : NULL;
+	subpass.preserveAttachmentCount			= 0;
+	subpass.pPreserveAttachments			= NULL;
+
+	VkRenderPassCreateInfo rpInfo			= {};
+	rpInfo.sType							= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	rpInfo.pNext							= NULL;
+	rpInfo.attachmentCount					= (uint32_t)attachments.size();
+	rpInfo.pAttachments						= attachments.data();
+	rpInfo.subpassCount						= 1;
+	rpInfo.pSubpasses						= &subpass;
+	rpInfo.dependencyCount					= (uint32_t)dependencies.size();
+	rpInfo.pDependencies					= dependencies.data();
+
+	VkRenderPass renderPass;
+	VkResult result = vkCreateRenderPass(device, &rpInfo, NULL, &renderPass);
+	assert(result == VK_SUCCESS);
+
+	return renderPass;
+}
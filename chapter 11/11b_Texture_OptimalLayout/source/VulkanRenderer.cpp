@@ -32,7 +32,13 @@ VulkanRenderer::VulkanRenderer(VulkanApplication * app, VulkanDevice* deviceObje
 {
 	// Note: It's very important to initilize the member with 0 or respective value other wise it will break the system
 	memset(&Depth, 0, sizeof(Depth));
+	memset(&texture, 0, sizeof(texture));
+	memset(&placeholderTexture, 0, sizeof(placeholderTexture));
 	memset(&connection, 0, sizeof(HINSTANCE));				// hInstance - Windows Instance
+	cmdInit				= VK_NULL_HANDLE;
+	initBatchRecording	= false;
+	backbufferResource	= RENDER_GRAPH_INVALID_INDEX;
+	depthResource		= RENDER_GRAPH_INVALID_INDEX;
 
 	application = app;
 	deviceObj	= deviceObject;
@@ -40,6 +46,32 @@ VulkanRenderer::VulkanRenderer(VulkanApplication * app, VulkanDevice* deviceObje
 	swapChainObj = new VulkanSwapChain(this);
 	VulkanDrawable* drawableObj = new VulkanDrawable(this);
 	drawableList.push_back(drawableObj);
+
+	recordGeneration	= 0;
+	pendingRecorders	= 0;
+	recordImage			= 0;
+	recordQuit			= false;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = NULL;
+	semaphoreCreateInfo.flags = 0;
+
+	// Create the fences in signaled state, so that the
+	// very first wait on each frame slot does not block.
+	VkFenceCreateInfo fenceCreateInfo;
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.pNext = NULL;
+	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	currentFrame = 0;
+	frames.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < frames.size(); i++) {
+		frames[i].cmdDraw = VK_NULL_HANDLE;
+		vkCreateSemaphore(deviceObj->device, &semaphoreCreateInfo, NULL, &frames[i].presentCompleteSemaphore);
+		vkCreateSemaphore(deviceObj->device, &semaphoreCreateInfo, NULL, &frames[i].drawingCompleteSemaphore);
+		vkCreateFence(deviceObj->device, &fenceCreateInfo, NULL, &frames[i].fence);
+	}
 }
 
 VulkanRenderer::~VulkanRenderer()
@@ -58,6 +90,19 @@ void VulkanRenderer::initialize()
 
 	// We need command buffers, so create a command buffer pool
 	createCommandPool();
+
+	// Staging memory for the texture and buffer uploads
+	stagingRing.create();
+
+	// GPU timestamp queries for each frame in flight
+	profiler.create(MAX_FRAMES_IN_FLIGHT);
+	stagingRing.setProfiler(&profiler);
+
+	// Uniform memory of the drawables for each frame in flight
+	uniformRing.create(MAX_FRAMES_IN_FLIGHT);
+
+	// Layout transitions and uploads below are submitted together
+	beginInitBatch();
 	
 	// Let's create the swap chain color images and depth image
 	buildSwapChainAndDepthImage();
@@ -78,7 +123,11 @@ void VulkanRenderer::initialize()
 	const char* filename = "../LearningVulkan.ktx";
 	bool renderOptimalTexture = true;
 	if (renderOptimalTexture) {
-		createTextureOptimal(filename, &texture, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+		// The texture file is decoded in the background, the drawables 
+		// sample a 1x1 placeholder until the texture is uploaded.
+		createPlaceholderTexture(&placeholderTexture);
+		textureLoader.create(&application->jobSystem);
+		textureLoader.load(filename, &texture, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_FORMAT_R8G8B8A8_UNORM);
 	}
 	else {
 		createTextureLinear(filename, &texture, VK_IMAGE_USAGE_SAMPLED_BIT);
@@ -86,34 +135,62 @@ void VulkanRenderer::initialize()
 	// Set the created texture in the drawable object.
 	for each (VulkanDrawable* drawableObj in drawableList)
 	{
-		drawableObj->setTextures(&texture);
+		drawableObj->setTextures(renderOptimalTexture ? &placeholderTexture : &texture);
 	}
 
+	// Submit the depth layout, vertex buffers and textures, then wait once
+	endInitBatch();
+
 	// Create descriptor set layout
 	createDescriptors();
 
 	// Manage the pipeline state objects
 	createPipelineStateManagement();
+
+	// Describe the passes of the frame
+	buildRenderGraph();
+}
+
+void VulkanRenderer::resize()
+{
+	// The render pass depends on the attachment formats only and the pipelines
+	// use dynamic viewport and scissor states, both remain valid for the new extent.
+	beginInitBatch();
+	swapChainObj->createSwapChain(cmdInit);
+	createDepthImage();
+	endInitBatch();
+	createFrameBuffer(true);
+	buildRenderGraph();
 }
 
 void VulkanRenderer::prepare()
 {
-	for each (VulkanDrawable* drawableObj in drawableList)
-	{
-		drawableObj->prepare();
+	// Allocate the primary command buffer for each frame in flight, 
+	// these are recorded in renderFrame() for the acquired image.
+	for (uint32_t i = 0; i < frames.size(); i++) {
+		CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &frames[i].cmdDraw);
 	}
+	currentFrame = 0;
+
+	createRecordingThreads();
 }
 
 void VulkanRenderer::update()
 {
-	for each (VulkanDrawable* drawableObj in drawableList)
-	{
-		drawableObj->update();
-	}
+	// The drawables update independent states, spread them over the workers
+	application->jobSystem.parallelFor((uint32_t)drawableList.size(), [this](uint32_t index) {
+		drawableList[index]->update();
+	});
 }
 
 bool VulkanRenderer::render()
 {
+	// No window and message loop in headless mode, draw directly
+	if (application->isHeadless) {
+		renderFrame();
+		return true;
+	}
+
 	MSG msg;   // message
 	PeekMessage(&msg, NULL, 0, 0, PM_REMOVE);
 	if (msg.message == WM_QUIT) {
@@ -125,6 +202,292 @@ bool VulkanRenderer::render()
 	return true;
 }
 
+void VulkanRenderer::renderFrame()
+{
+	FrameData& frame				= frames[currentFrame];
+	uint32_t& currentColorImage		= swapChainObj->scPublicVars.currentColorBuffer;
+
+	// Without swapchain (headless mode) there is no acquire and present to synchronize with
+	const bool presenting			= !application->isHeadless;
+
+	// Wait until the GPU is done with the frame submitted
+	// MAX_FRAMES_IN_FLIGHT frames ago using this same slot.
+	VkResult result = vkWaitForFences(deviceObj->device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+	assert(result == VK_SUCCESS);
+
+	// Get the index of the next available swapchain image:
+	result = swapChainObj->acquireNextImage(frame.presentCompleteSemaphore, &currentColorImage);
+	assert(result == VK_SUCCESS);
+
+	// The uniform data of the frame slot is no more read by the GPU
+	uniformRing.beginFrame(currentFrame);
+
+	// Upload the textures decoded in the background, then refresh the 
+	// descriptor sets of this frame slot which the GPU does not use anymore
+	streamTextures();
+	for each (VulkanDrawable* drawableObj in drawableList)
+	{
+		drawableObj->updateDescriptorSet(currentFrame);
+	}
+
+	// Record the frame's command buffer for the acquired image.
+	// The previous recording is no more in use as the fence is signaled.
+	result = vkResetCommandBuffer(frame.cmdDraw, 0);
+	assert(result == VK_SUCCESS);
+	CommandBufferMgr::beginCommandBuffer(frame.cmdDraw);
+	profiler.beginFrame(currentFrame, frame.cmdDraw);
+
+	// The passes of the frame render into the acquired image
+	SwapChainBuffer& backbuffer = swapChainObj->scPublicVars.colorBuffer[currentColorImage];
+	renderGraph.setImportedImage(backbufferResource, backbuffer.image, backbuffer.view);
+	renderGraph.execute(frame.cmdDraw);
+	CommandBufferMgr::endCommandBuffer(frame.cmdDraw);
+
+	// Make the uniform data written while recording visible to the device
+	uniformRing.flush();
+
+	VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext				= NULL;
+	submitInfo.waitSemaphoreCount	= presenting ? 1 : 0;
+	submitInfo.pWaitSemaphores		= &frame.presentCompleteSemaphore;
+	submitInfo.pWaitDstStageMask	= &submitPipelineStages;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &frame.cmdDraw;
+	submitInfo.signalSemaphoreCount = presenting ? 1 : 0;
+	submitInfo.pSignalSemaphores	= &frame.drawingCompleteSemaphore;
+
+	// Reset the fence only when the work is about to be 
+	// submitted, the submission signals it again on completion.
+	result = vkResetFences(deviceObj->device, 1, &frame.fence);
+	assert(result == VK_SUCCESS);
+
+	// Queue the command buffer for execution, the fence lets the 
+	// CPU move on to the next frame without waiting for the queue
+	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &frame.cmdDraw, &submitInfo, frame.fence);
+
+	// Queue the image for presentation in the window
+	result = swapChainObj->queuePresent(deviceObj->queue, currentColorImage, frame.drawingCompleteSemaphore);
+	assert(result == VK_SUCCESS);
+
+	// Advance to the next frame slot
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void VulkanRenderer::buildRenderGraph()
+{
+	renderGraph.begin(&resourceTracker);
+
+	// The swapchain image is set for each frame once acquired
+	backbufferResource = renderGraph.importImage("Backbuffer", VK_IMAGE_ASPECT_COLOR_BIT);
+	renderGraph.markOutput(backbufferResource);
+
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (Depth.format == VK_FORMAT_D16_UNORM_S8_UINT ||
+		Depth.format == VK_FORMAT_D24_UNORM_S8_UINT ||
+		Depth.format == VK_FORMAT_D32_SFLOAT_S8_UINT) {
+		depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+	depthResource = renderGraph.importImage("Depth", depthAspect);
+	renderGraph.setImportedImage(depthResource, Depth.image, Depth.view);
+
+	// The render pass clears both attachments from the undefined layout
+	// and leaves them in the final layouts of its attachment descriptions.
+	uint32_t mainPass = renderGraph.addPass("Main", [this](VkCommandBuffer cmd) {
+		recordCommandBuffer(swapChainObj->scPublicVars.currentColorBuffer, cmd);
+	});
+	renderGraph.writeImage(mainPass, backbufferResource, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		application->isHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	renderGraph.writeImage(mainPass, depthResource, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+	renderGraph.compile();
+}
+
+void VulkanRenderer::recordCommandBuffer(uint32_t currentImage, VkCommandBuffer cmdDraw)
+{
+	// Specify the clear color value
+	VkClearValue clearValues[2];
+	clearValues[0].color.float32[0]		= 1.0f;
+	clearValues[0].color.float32[1]		= 1.0f;
+	clearValues[0].color.float32[2]		= 1.0f;
+	clearValues[0].color.float32[3]		= 1.0f;
+
+	// Specify the depth/stencil clear value
+	clearValues[1].depthStencil.depth	= 1.0f;
+	clearValues[1].depthStencil.stencil	= 0;
+
+	// Define the VkRenderPassBeginInfo control structure
+	VkRenderPassBeginInfo renderPassBegin;
+	renderPassBegin.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBegin.pNext						= NULL;
+	renderPassBegin.renderPass					= renderPass;
+	renderPassBegin.framebuffer					= framebuffers[currentImage];
+	renderPassBegin.renderArea.offset.x			= 0;
+	renderPassBegin.renderArea.offset.y			= 0;
+	renderPassBegin.renderArea.extent.width		= width;
+	renderPassBegin.renderArea.extent.height	= height;
+	renderPassBegin.clearValueCount				= 2;
+	renderPassBegin.pClearValues				= clearValues;
+
+	// Measure the GPU time of the whole render pass instance
+	uint32_t renderPassScope = profiler.beginScope(cmdDraw, "RenderPass");
+
+	if (recordingThreads.empty()) {
+		// Record all the drawables inline on the rendering thread
+		vkCmdBeginRenderPass(cmdDraw, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+		for each (VulkanDrawable* drawableObj in drawableList)
+		{
+			drawableObj->recordCommandBuffer(cmdDraw);
+		}
+		vkCmdEndRenderPass(cmdDraw);
+		profiler.endScope(cmdDraw, renderPassScope);
+		return;
+	}
+
+	// The command pools of the frame slot are not in use by the GPU 
+	// anymore, reset them before the workers record into them again.
+	for each (RecordingThread* recorder in recordingThreads)
+	{
+		vkResetCommandPool(deviceObj->device, recorder->cmdPools[currentFrame], 0);
+	}
+
+	// Wake up the workers and wait for them to record their drawables
+	{
+		std::unique_lock<std::mutex> lock(recordMutex);
+		recordImage			= currentImage;
+		pendingRecorders	= (uint32_t)recordingThreads.size();
+		recordGeneration++;
+		recordStart.notify_all();
+		recordDone.wait(lock, [this] { return pendingRecorders == 0; });
+	}
+
+	// Stitch the secondary command buffers into the render pass instance
+	std::vector<VkCommandBuffer> secondaryCmds;
+	for each (RecordingThread* recorder in recordingThreads)
+	{
+		if (recorder->hasCommands) {
+			secondaryCmds.push_back(recorder->cmdBufs[currentFrame]);
+		}
+	}
+
+	vkCmdBeginRenderPass(cmdDraw, &renderPassBegin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	if (!secondaryCmds.empty()) {
+		vkCmdExecuteCommands(cmdDraw, (uint32_t)secondaryCmds.size(), secondaryCmds.data());
+	}
+	vkCmdEndRenderPass(cmdDraw);
+	profiler.endScope(cmdDraw, renderPassScope);
+}
+
+void VulkanRenderer::createRecordingThreads()
+{
+	if (!recordingThreads.empty()) {
+		return;
+	}
+
+	VkResult  result;
+
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.pNext				= NULL;
+	cmdPoolInfo.queueFamilyIndex	= deviceObj->graphicsQueueWithPresentIndex;
+	cmdPoolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandBufferAllocateInfo cmdInfo = {};
+	cmdInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cmdInfo.pNext				= NULL;
+	cmdInfo.level				= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	cmdInfo.commandBufferCount	= 1;
+
+	recordQuit = false;
+	for (uint32_t i = 0; i < RECORDING_THREAD_COUNT; i++) {
+		RecordingThread* recorder = new RecordingThread();
+		recorder->hasCommands = false;
+
+		for (uint32_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++) {
+			result = vkCreateCommandPool(deviceObj->device, &cmdPoolInfo, NULL, &recorder->cmdPools[j]);
+			assert(result == VK_SUCCESS);
+
+			cmdInfo.commandPool = recorder->cmdPools[j];
+			CommandBufferMgr::allocCommandBuffer(&deviceObj->device, recorder->cmdPools[j], &recorder->cmdBufs[j], &cmdInfo);
+		}
+
+		recordingThreads.push_back(recorder);
+	}
+
+	// Start the workers once all of them are in the list
+	for (uint32_t i = 0; i < recordingThreads.size(); i++) {
+		recordingThreads[i]->thread = std::thread(&VulkanRenderer::recordingThreadMain, this, i);
+	}
+}
+
+void VulkanRenderer::recordingThreadMain(uint32_t threadIndex)
+{
+	uint64_t generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(recordMutex);
+			recordStart.wait(lock, [&] { return recordQuit || recordGeneration != generation; });
+			if (recordQuit) {
+				return;
+			}
+			generation = recordGeneration;
+		}
+
+		recordSecondaryCommandBuffer(threadIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(recordMutex);
+			pendingRecorders--;
+		}
+		recordDone.notify_one();
+	}
+}
+
+void VulkanRenderer::recordSecondaryCommandBuffer(uint32_t threadIndex)
+{
+	RecordingThread* recorder	= recordingThreads[threadIndex];
+	uint32_t threadCount		= (uint32_t)recordingThreads.size();
+	uint32_t drawableCount		= (uint32_t)drawableList.size();
+
+	// Contiguous partition of the drawables for this worker
+	uint32_t first	= threadIndex * drawableCount / threadCount;
+	uint32_t last	= (threadIndex + 1) * drawableCount / threadCount;
+
+	recorder->hasCommands = (first < last);
+	if (!recorder->hasCommands) {
+		return;
+	}
+
+	// The secondary command buffer executes entirely inside the render pass instance
+	VkCommandBufferInheritanceInfo inheritInfo = {};
+	inheritInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritInfo.pNext					= NULL;
+	inheritInfo.renderPass				= renderPass;
+	inheritInfo.subpass					= 0;
+	inheritInfo.framebuffer				= framebuffers[recordImage];
+	inheritInfo.occlusionQueryEnable	= VK_FALSE;
+	inheritInfo.queryFlags				= 0;
+	inheritInfo.pipelineStatistics		= 0;
+
+	VkCommandBufferBeginInfo cmdBufInfo = {};
+	cmdBufInfo.sType			= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBufInfo.pNext			= NULL;
+	cmdBufInfo.flags			= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBufInfo.pInheritanceInfo	= &inheritInfo;
+
+	VkCommandBuffer cmdDraw = recorder->cmdBufs[currentFrame];
+	CommandBufferMgr::beginCommandBuffer(cmdDraw, &cmdBufInfo);
+	for (uint32_t i = first; i < last; i++) {
+		drawableList[i]->recordCommandBuffer(cmdDraw);
+	}
+	CommandBufferMgr::endCommandBuffer(cmdDraw);
+}
+
 #ifdef _WIN32
 
 // MS-Windows event handling function:
@@ -137,9 +500,8 @@ LRESULT CALLBACK VulkanRenderer::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LP
 		PostQuitMessage(0);
 		break;
 	case WM_PAINT:
-		for each (VulkanDrawable* drawableObj in appObj->rendererObj->drawableList)
-		{
-			drawableObj->render();
+		if (appObj->isPrepared) {
+			appObj->rendererObj->renderFrame();
 		}
 
 		return 0;
@@ -300,12 +662,43 @@ void VulkanRenderer::createCommandPool()
 	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	cmdPoolInfo.pNext = NULL;
 	cmdPoolInfo.queueFamilyIndex = deviceObj->graphicsQueueWithPresentIndex;
-	cmdPoolInfo.flags = 0;
+	// Drawing command buffers are re-recorded for every frame in flight
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	res = vkCreateCommandPool(deviceObj->device, &cmdPoolInfo, NULL, &cmdPool);
 	assert(res == VK_SUCCESS);
 }
 
+void VulkanRenderer::beginInitBatch()
+{
+	assert(!initBatchRecording);
+
+	// The command buffer is reused by the next batch, on resize. The pool 
+	// allows to reset it and the previous batch has completed.
+	if (cmdInit == VK_NULL_HANDLE) {
+		CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &cmdInit);
+	}
+	CommandBufferMgr::beginCommandBuffer(cmdInit);
+	initBatchRecording = true;
+}
+
+void VulkanRenderer::endInitBatch()
+{
+	assert(initBatchRecording);
+	initBatchRecording = false;
+
+	// The staged copies of the batch in a single submission, their 
+	// barriers are merged at the end of the upload command buffer.
+	stagingRing.submit();
+
+	// The layout transitions don't depend on the uploads, submit them in a
+	// single barrier and wait once. The uploads may run on the transfer queue.
+	initBarriers.flush(cmdInit);
+	CommandBufferMgr::endCommandBuffer(cmdInit);
+	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &cmdInit);
+	stagingRing.waitIdle();
+}
+
 void VulkanRenderer::createDepthImage()
 {
 	VkResult  result;
@@ -334,35 +727,18 @@ void VulkanRenderer::createDepthImage()
 	imageInfo.queueFamilyIndexCount = 0;
 	imageInfo.pQueueFamilyIndices	= NULL;
 	imageInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.usage					= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	// The depth content is neither loaded nor stored by the render pass
+	imageInfo.usage					= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
 	imageInfo.flags					= 0;
 
 	// User create image info and create the image objects
 	result = vkCreateImage(deviceObj->device, &imageInfo, NULL, &Depth.image);
 	assert(result == VK_SUCCESS);
 
-	// Get the image memory requirements
-	VkMemoryRequirements memRqrmnt;
-	vkGetImageMemoryRequirements(deviceObj->device,	Depth.image, &memRqrmnt);
-
-	VkMemoryAllocateInfo memAlloc = {};
-	memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAlloc.pNext = NULL;
-	memAlloc.allocationSize = 0;
-	memAlloc.memoryTypeIndex = 0;
-	memAlloc.allocationSize = memRqrmnt.size;
-	// Determine the type of memory required with the help of memory properties
-	pass = deviceObj->memoryTypeFromProperties(memRqrmnt.memoryTypeBits, 0, /* No requirements */ &memAlloc.memoryTypeIndex);
+	// Bind lazily allocated memory if available, tilers keep the depth in tile memory
+	pass = deviceObj->memoryAllocator->allocateTransientImageMemory(Depth.image, &Depth.mem);
 	assert(pass);
 
-	// Allocate the memory for image objects
-	result = vkAllocateMemory(deviceObj->device, &memAlloc, NULL, &Depth.mem);
-	assert(result == VK_SUCCESS);
-
-	// Bind the allocated memeory
-	result = vkBindImageMemory(deviceObj->device, Depth.image, Depth.mem, 0);
-	assert(result == VK_SUCCESS);
-
 
 	VkImageViewCreateInfo imgViewInfo = {};
 	imgViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -384,25 +760,21 @@ void VulkanRenderer::createDepthImage()
 		imgViewInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
 	}
 
-	// Use command buffer to create the depth image. This includes -
-	// Command buffer allocation, recording with begin/end scope and submission.
-	CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &cmdDepthImage);
-	CommandBufferMgr::beginCommandBuffer(cmdDepthImage);
+	// The depth image layout is set by the init batch command buffer, 
+	// it is submitted with the other initialization commands.
+	assert(initBatchRecording);
 	{
+		// The depth and stencil aspects are transitioned together
 		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		subresourceRange.aspectMask = imgViewInfo.subresourceRange.aspectMask;
 		subresourceRange.baseMipLevel = 0;
 		subresourceRange.levelCount = 1;
 		subresourceRange.layerCount = 1;
 
 		// Set the image layout to depth stencil optimal
-		setImageLayout(Depth.image,
-			imgViewInfo.subresourceRange.aspectMask,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, subresourceRange, cmdDepthImage);
+		resourceTracker.registerImage(Depth.image, 1, 1);
+		resourceTracker.useImage(initBarriers, Depth.image, subresourceRange, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 	}
-	CommandBufferMgr::endCommandBuffer(cmdDepthImage);
-	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &cmdDepthImage);
 
 	// Create the image view and allow the application to use the images.
 	imgViewInfo.image = Depth.image;
@@ -415,6 +787,36 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 	// Load the image 
 	gli::texture2D image2D(gli::load(filename)); assert(!image2D.empty());
 
+	createTextureOptimal(image2D, texture, imageUsageFlags, format);
+}
+
+void VulkanRenderer::createPlaceholderTexture(TextureData *texture)
+{
+	// Single opaque white texel
+	gli::texture2D image2D(gli::FORMAT_RGBA8_UNORM, gli::texture2D::dim_type(1, 1), 1);
+	memset(image2D.data(), 0xff, image2D.size());
+
+	createTextureOptimal(image2D, texture, VK_IMAGE_USAGE_SAMPLED_BIT, VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+void VulkanRenderer::streamTextures()
+{
+	VulkanTextureLoader::Request decoded;
+	while (textureLoader.fetchDecoded(&decoded)) {
+		// The upload is submitted before the frame on the same queue
+		createTextureOptimal(*decoded.image, decoded.texture, decoded.imageUsageFlags, decoded.format);
+		delete decoded.image;
+
+		// All the drawables of this sample share the streamed texture
+		for each (VulkanDrawable* drawableObj in drawableList)
+		{
+			drawableObj->setTextures(decoded.texture);
+		}
+	}
+}
+
+void VulkanRenderer::createTextureOptimal(const gli::texture2D& image2D, TextureData *texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
+{
 	// Get the image dimensions
 	texture->textureWidth	= uint32_t(image2D[0].dimensions().x);
 	texture->textureHeight	= uint32_t(image2D[0].dimensions().y);
@@ -422,51 +824,7 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 	// Get number of mip-map levels
 	texture->mipMapLevels	= uint32_t(image2D.levels());
 
-	// Create a staging buffer resource states using.
-	// Indicate it be the source of the transfer command.
-	// .usage	= VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-	VkBufferCreateInfo bufferCreateInfo = {};
-	bufferCreateInfo.sType	= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.size	= image2D.size();
-	bufferCreateInfo.usage	= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
 	VkResult error;
-	// Create a buffer resource (host-visible) -
-	VkBuffer buffer;
-	error = vkCreateBuffer(deviceObj->device, &bufferCreateInfo, NULL, &buffer);
-	assert(!error);
-	
-	// Get the buffer memory requirements for the staging buffer -
-	VkMemoryRequirements memRqrmnt;
-	VkDeviceMemory	devMemory;
-	vkGetBufferMemoryRequirements(deviceObj->device, buffer, &memRqrmnt);
-
-	VkMemoryAllocateInfo memAllocInfo = {};
-	memAllocInfo.sType			= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.pNext			= NULL;
-	memAllocInfo.allocationSize = 0;
-	memAllocInfo.memoryTypeIndex= 0;
-	memAllocInfo.allocationSize = memRqrmnt.size;
-
-	// Determine the type of memory required for the host-visible buffer  -
-	deviceObj->memoryTypeFromProperties(memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &memAllocInfo.memoryTypeIndex);
-		
-	// Allocate the memory for host-visible buffer objects -
-	error = vkAllocateMemory(deviceObj->device, &memAllocInfo, nullptr, &devMemory);
-	assert(!error);
-
-	// Bind the host-visible buffer with allocated device memory -
-	error = vkBindBufferMemory(deviceObj->device, buffer, devMemory, 0);
-	assert(!error);
-
-	// Populate the raw image data into the device memory -
-	uint8_t *data;
-	error = vkMapMemory(deviceObj->device, devMemory, 0, memRqrmnt.size, 0, (void **)&data);
-	assert(!error);
-
-	memcpy(data, image2D.data(), image2D.size());
-	vkUnmapMemory(deviceObj->device, devMemory);
 
 	// Create image info with optimal tiling support (.tiling = VK_IMAGE_TILING_OPTIMAL) -
 	VkImageCreateInfo imageCreateInfo = {};
@@ -494,22 +852,9 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 	error = vkCreateImage(deviceObj->device, &imageCreateInfo, nullptr, &texture->image);
 	assert(!error);
 
-	// Get the image memory requirements
-	vkGetImageMemoryRequirements(deviceObj->device, texture->image, &memRqrmnt);
-
-	// Set the allocation size equal to the buffer allocation
-	memAllocInfo.allocationSize = memRqrmnt.size;
-
-	// Determine the type of memory required with the help of memory properties
-	deviceObj->memoryTypeFromProperties(memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memAllocInfo.memoryTypeIndex);
-
-	// Allocate the physical memory on the GPU
-	error = vkAllocateMemory(deviceObj->device, &memAllocInfo, nullptr, &texture->mem);
-	assert(!error);
-
-	// Bound the physical memory with the created image object 
-	error = vkBindImageMemory(deviceObj->device, texture->image, texture->mem, 0);
-	assert(!error);
+	// Sub-allocate the device local memory and bound it with the created image object 
+	bool pass = deviceObj->memoryAllocator->allocateImageMemory(texture->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, false, &texture->mem);
+	assert(pass);
 
 	VkImageSubresourceRange subresourceRange = {};
 	subresourceRange.aspectMask				= VK_IMAGE_ASPECT_COLOR_BIT;
@@ -517,17 +862,15 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 	subresourceRange.levelCount				= texture->mipMapLevels;
 	subresourceRange.layerCount				= 1;
 
-	// Use a separate command buffer for texture loading
-	// Start command buffer recording
-	CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &cmdTexture);
-	CommandBufferMgr::beginCommandBuffer(cmdTexture);
-
+	// The upload commands are recorded in the staging ring command buffer
 	// set the image layout to be 
 	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
 	// since it is destination for copying buffer 
 	// into image using vkCmdCopyBufferToImage -
-	setImageLayout(texture->image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange, cmdTexture);
+	// The transitions of all the images staged before the submission are 
+	// merged into a single barrier recorded ahead of their copies.
+	resourceTracker.registerImage(texture->image, texture->mipMapLevels, 1);
+	resourceTracker.useImage(stagingRing.getCopyBarriers(), texture->image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
 	// List contains the buffer image copy for each mipLevel -
 	std::vector<VkBufferImageCopy> bufferImgCopyList;
@@ -553,49 +896,26 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 		bufferOffset += uint32_t(image2D[i].size());
 	}
 
-	// Copy the staging buffer memory data contain
-	// the stage raw data(with mip levels) into image object
-	vkCmdCopyBufferToImage(cmdTexture, buffer, texture->image,	
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		uint32_t(bufferImgCopyList.size()), bufferImgCopyList.data());
+	// Stage the raw data(with mip levels) in the ring and copy it into 
+	// the image object, big images are split over several submissions
+	stagingRing.copyToImage(texture->image, image2D.data(), image2D.size(), bufferImgCopyList);
 
 	// Advised to change the image layout to shader read
 	// after staged buffer copied into image memory -
+	// On a transfer only queue the image ownership is handed to the graphics queue.
 	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	setImageLayout(texture->image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		texture->imageLayout, subresourceRange, cmdTexture);
-
-
-	// Submit command buffer containing copy and image layout commands-
-	CommandBufferMgr::endCommandBuffer(cmdTexture);
-
-	// Create a fence object to ensure that the command buffer is executed,
-	// coping our staged raw data from the buffers to image memory with
-	// respective image layout and attributes into consideration -
-	VkFence fence;
-	VkFenceCreateInfo fenceCI	= {};
-	fenceCI.sType				= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCI.flags				= 0;
-
-	error = vkCreateFence(deviceObj->device, &fenceCI, nullptr, &fence);
-	assert(!error);
-
-	VkSubmitInfo submitInfo			= {};
-	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext				= NULL;
-	submitInfo.commandBufferCount	= 1;
-	submitInfo.pCommandBuffers		= &cmdTexture;
-
-	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &cmdTexture, &submitInfo, fence);
-
-	error = vkWaitForFences(deviceObj->device, 1, &fence, VK_TRUE, 10000000000);
-	assert(!error);
-
-	vkDestroyFence(deviceObj->device, fence, nullptr);
-
-	// destroy the allocated resoureces
-	vkFreeMemory(deviceObj->device, devMemory, nullptr);
-	vkDestroyBuffer(deviceObj->device, buffer, nullptr);
+	stagingRing.finishImageUpload(texture->image, subresourceRange, texture->imageLayout,
+		VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	resourceTracker.setImageState(texture->image, subresourceRange, texture->imageLayout,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	// Submit the copy and image layout commands, the drawing commands are 
+	// submitted later on the same queue hence no need to wait here. The 
+	// staging space is reclaimed by the ring once the upload is complete.
+	// During the init batch the submission is deferred to endInitBatch().
+	if (!initBatchRecording) {
+		stagingRing.submit();
+	}
 
 	///////////////////////////////////////////////////////////////////////////////////////
 
@@ -649,7 +969,7 @@ void VulkanRenderer::createTextureOptimal(const char* filename, TextureData *tex
 	// Fill descriptor image info that can be used for setting up descriptor sets
 	texture->descsImgInfo.imageView = texture->view;
 	texture->descsImgInfo.sampler = texture->sampler;
-	texture->descsImgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	texture->descsImgInfo.imageLayout = texture->imageLayout;
 }
 
 void VulkanRenderer::createTextureLinear(const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
@@ -689,31 +1009,11 @@ void VulkanRenderer::createTextureLinear(const char* filename, TextureData *text
 	error = vkCreateImage(deviceObj->device, &imageCreateInfo, NULL, &texture->image);
 	assert(!error);
 
-	// Get the buffer memory requirements
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(deviceObj->device, texture->image, &memoryRequirements);
-
-	// Create memory allocation metadata information
-	VkMemoryAllocateInfo& memAlloc	= texture->memoryAlloc;
-	memAlloc.sType					= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAlloc.pNext					= NULL;
-	memAlloc.allocationSize			= memoryRequirements.size;
-	memAlloc.memoryTypeIndex		= 0;
-
-	// Determine the type of memory required 
-	// with the help of memory properties
-	bool pass = deviceObj->memoryTypeFromProperties(memoryRequirements.memoryTypeBits,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &texture->memoryAlloc.memoryTypeIndex);
+	// Sub-allocate host visible memory for the linear image and bind it
+	bool pass = deviceObj->memoryAllocator->allocateImageMemory(texture->image,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 0, true, &texture->mem);
 	assert(pass);
 
-	// Allocate the memory for buffer objects
-	error = vkAllocateMemory(deviceObj->device, &texture->memoryAlloc, NULL, &(texture->mem));
-	assert(!error);
-
-	// Bind the image device memory 
-	error = vkBindImageMemory(deviceObj->device, texture->image, texture->mem, 0);
-	assert(!error);
-
 	VkImageSubresource subresource	= {};
 	subresource.aspectMask			= VK_IMAGE_ASPECT_COLOR_BIT;
 	subresource.mipLevel			= 0;
@@ -724,9 +1024,8 @@ void VulkanRenderer::createTextureLinear(const char* filename, TextureData *text
 
 	vkGetImageSubresourceLayout(deviceObj->device, texture->image, &subresource, &layout);
 
-	// Map the GPU memory on to local host
-	error = vkMapMemory(deviceObj->device, texture->mem, 0, texture->memoryAlloc.allocationSize, 0, (void**)&data);
-	assert(!error);
+	// Host address of the image memory in the persistently mapped block
+	data = texture->mem.pMapped;
 
 	// Load image texture data in the mapped buffer
 	uint8_t* dataTemp = (uint8_t*)image2D.data();
@@ -740,12 +1039,19 @@ void VulkanRenderer::createTextureLinear(const char* filename, TextureData *text
 		data += layout.rowPitch;
 	}
 
-	// UnMap the host memory to push the changes into the device memory
-	vkUnmapMemory(deviceObj->device, texture->mem);
+	// Push the changes into the device memory if it is not host coherent
+	if (!(deviceObj->memoryProperties.memoryTypes[texture->mem.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		VkMappedMemoryRange range	= {};
+		range.sType					= VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory				= texture->mem.memory;
+		range.offset				= texture->mem.offset;
+		range.size					= texture->mem.size;
+		error = vkFlushMappedMemoryRanges(deviceObj->device, 1, &range);
+		assert(!error);
+	}
 	
-	// Command buffer allocation and recording begins
-	CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &cmdTexture);
-	CommandBufferMgr::beginCommandBuffer(cmdTexture);
+	// The layout transition is recorded in the init batch command buffer
+	assert(initBatchRecording);
 
 	VkImageSubresourceRange subresourceRange	= {};
 	subresourceRange.aspectMask					= VK_IMAGE_ASPECT_COLOR_BIT;
@@ -754,30 +1060,8 @@ void VulkanRenderer::createTextureLinear(const char* filename, TextureData *text
 	subresourceRange.layerCount					= 1;
 
 	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	setImageLayout(texture->image, VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_IMAGE_LAYOUT_PREINITIALIZED, texture->imageLayout,
-		subresourceRange, cmdTexture);
-
-	// Stop command buffer recording
-	CommandBufferMgr::endCommandBuffer(cmdTexture);
-
-	// Ensure that the GPU has finished the submitted job before host takes over again 
-	VkFence fence;
-	VkFenceCreateInfo fenceCI = {};
-	fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCI.flags = 0;
-
-	vkCreateFence(deviceObj->device, &fenceCI, nullptr, &fence);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext = NULL;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdTexture;
-
-	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &cmdTexture, &submitInfo, fence);
-	vkWaitForFences(deviceObj->device, 1, &fence, VK_TRUE, 10000000000);
-	vkDestroyFence(deviceObj->device, fence, nullptr);
+	resourceTracker.registerImage(texture->image, texture->mipMapLevels, 1, VK_IMAGE_LAYOUT_PREINITIALIZED);
+	resourceTracker.useImage(initBarriers, texture->image, subresourceRange, texture->imageLayout);
 
 	// Specify a particular kind of texture using samplers
 	VkSamplerCreateInfo samplerCI	= {};
@@ -830,7 +1114,7 @@ void VulkanRenderer::createTextureLinear(const char* filename, TextureData *text
 
 	texture->descsImgInfo.sampler		= texture->sampler;
 	texture->descsImgInfo.imageView		= texture->view;
-	texture->descsImgInfo.imageLayout	= VK_IMAGE_LAYOUT_GENERAL;
+	texture->descsImgInfo.imageLayout	= texture->imageLayout;
 
 	// Set the created texture in the drawable object.
 	for each (VulkanDrawable* drawableObj in drawableList)
@@ -844,71 +1128,37 @@ void VulkanRenderer::createRenderPass(bool isDepthSupported, bool clear)
 	// Dependency on VulkanSwapChain::createSwapChain() to 
 	// get the color surface image and VulkanRenderer::createDepthBuffer()
 	// to get the depth buffer image.
-	
-	VkResult  result;
-	// Attach the color buffer and depth buffer as an attachment to render pass instance
-	VkAttachmentDescription attachments[2];
-	attachments[0].format					= swapChainObj->scPublicVars.format;
-	attachments[0].samples					= NUM_SAMPLES;
-	attachments[0].loadOp					= clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attachments[0].storeOp					= VK_ATTACHMENT_STORE_OP_STORE;
-	attachments[0].stencilLoadOp			= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attachments[0].stencilStoreOp			= VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachments[0].initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
-	attachments[0].finalLayout				= VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	attachments[0].flags					= VK_ATTACHMENT_DESCRIPTION_MAY_ALIAS_BIT;
-
-	// Is the depth buffer present the define attachment properties for depth buffer attachment.
-	if (isDepthSupported)
-	{
-		attachments[1].format				= Depth.format;
-		attachments[1].samples				= NUM_SAMPLES;
-		attachments[1].loadOp				= clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[1].storeOp				= VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[1].stencilLoadOp		= VK_ATTACHMENT_LOAD_OP_LOAD;
-		attachments[1].stencilStoreOp		= VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[1].initialLayout		= VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[1].finalLayout			= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		attachments[1].flags				= VK_ATTACHMENT_DESCRIPTION_MAY_ALIAS_BIT;
+	const VkAttachmentLoadOp loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+	// Offscreen images in headless mode are left ready to be read back
+	const bool headless = application->isHeadless;
+
+	VulkanRenderPassDescription description;
+	description.addColorAttachment(swapChainObj->scPublicVars.format, NUM_SAMPLES, loadOp, VK_ATTACHMENT_STORE_OP_STORE,
+		headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	// The depth buffer is not read after the render pass, its content and 
+	// the unused stencil are neither loaded nor stored.
+	if (isDepthSupported) {
+		description.addDepthStencilAttachment(Depth.format, NUM_SAMPLES, loadOp);
 	}
 
-	// Define the color buffer attachment binding point and layout information
-	VkAttachmentReference colorReference	= {};
-	colorReference.attachment				= 0;
-	colorReference.layout					= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Define the depth buffer attachment binding point and layout information
-	VkAttachmentReference depthReference = {};
-	depthReference.attachment				= 1;
-	depthReference.layout					= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	// Specify the attachments - color, depth, resolve, preserve etc.
-	VkSubpassDescription subpass			= {};
-	subpass.pipelineBindPoint				= VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.flags							= 0;
-	subpass.inputAttachmentCount			= 0;
-	subpass.pInputAttachments				= NULL;
-	subpass.colorAttachmentCount			= 1;
-	subpass.pColorAttachments				= &colorReference;
-	subpass.pResolveAttachments				= NULL;
-	subpass.pDepthStencilAttachment			= isDepthSupported ? &depthReference : NULL;
-	subpass.preserveAttachmentCount			= 0;
-	subpass.pPreserveAttachments			= NULL;
-
-	// Specify the attachement and subpass associate with render pass
-	VkRenderPassCreateInfo rpInfo			= {};
-	rpInfo.sType							= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	rpInfo.pNext							= NULL;
-	rpInfo.attachmentCount					= isDepthSupported ? 2 : 1;
-	rpInfo.pAttachments						= attachments;
-	rpInfo.subpassCount						= 1;
-	rpInfo.pSubpasses						= &subpass;
-	rpInfo.dependencyCount					= 0;
-	rpInfo.pDependencies					= NULL;
+	// The color output waits for the acquire semaphore, and the depth tests 
+	// of the frame wait for the depth writes of the previous frame.
+	description.addDependency(VK_SUBPASS_EXTERNAL, 0,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+	// The color writes complete before the presentation or the read back
+	description.addDependency(0, VK_SUBPASS_EXTERNAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		headless ? VK_ACCESS_TRANSFER_READ_BIT : 0);
 
 	// Create the render pass object
-	result = vkCreateRenderPass(deviceObj->device, &rpInfo, NULL, &renderPass);
-	assert(result == VK_SUCCESS);
+	renderPass = description.create(deviceObj->device);
 }
 
 void VulkanRenderer::createFrameBuffer(bool includeDepth)
@@ -947,6 +1197,11 @@ void VulkanRenderer::destroyFramebuffers()
 	framebuffers.clear();
 }
 
+void VulkanRenderer::destroyRenderGraph()
+{
+	renderGraph.destroy();
+}
+
 void VulkanRenderer::destroyRenderpass()
 {
 	vkDestroyRenderPass(deviceObj->device, renderPass, NULL);
@@ -957,52 +1212,97 @@ void VulkanRenderer::destroyDrawableVertexBuffer()
 	for each (VulkanDrawable* drawableObj in drawableList)
 	{
 		drawableObj->destroyVertexBuffer();
+		drawableObj->destroyInstanceBuffer();
 	}
 }
 
-void VulkanRenderer::destroyDrawableUniformBuffer()
+void VulkanRenderer::destroyUniformRing()
 {
-	for each (VulkanDrawable* drawableObj in drawableList)
+	uniformRing.destroy();
+}
+
+void VulkanRenderer::destroyTextureResource()
+{
+	TextureData* textureList[] = { &texture, &placeholderTexture };
+	for each (TextureData* textureObj in textureList)
 	{
-		drawableObj->destroyUniformBuffer();
+		// The streamed texture may not be resident yet
+		if (textureObj->image == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		vkDestroySampler(deviceObj->device, textureObj->sampler, NULL);
+		vkDestroyImageView(deviceObj->device, textureObj->view, NULL);
+		resourceTracker.unregisterImage(textureObj->image);
+		vkDestroyImage(deviceObj->device, textureObj->image, NULL);
+		deviceObj->memoryAllocator->free(&textureObj->mem);
+		memset(textureObj, 0, sizeof(TextureData));
 	}
 }
 
-void VulkanRenderer::destroyTextureResource()
+void VulkanRenderer::destroyTextureLoader()
 {
-	vkFreeMemory(deviceObj->device, texture.mem, NULL);
-	vkDestroySampler(deviceObj->device, texture.sampler, NULL);
-	vkDestroyImage(deviceObj->device, texture.image, NULL);
-	vkDestroyImageView(deviceObj->device, texture.view, NULL);
+	textureLoader.destroy();
 }
 
-void VulkanRenderer::destroyDrawableCommandBuffer()
+void VulkanRenderer::destroyFrameCommandBuffers()
 {
-	for each (VulkanDrawable* drawableObj in drawableList)
-	{
-		drawableObj->destroyCommandBuffer();
+	for (uint32_t i = 0; i < frames.size(); i++) {
+		vkFreeCommandBuffers(deviceObj->device, cmdPool, 1, &frames[i].cmdDraw);
+		frames[i].cmdDraw = VK_NULL_HANDLE;
 	}
 }
 
-void VulkanRenderer::destroyDrawableSynchronizationObjects()
+void VulkanRenderer::destroyFrameSynchronizationObjects()
+{
+	for (uint32_t i = 0; i < frames.size(); i++) {
+		vkDestroySemaphore(deviceObj->device, frames[i].presentCompleteSemaphore, NULL);
+		vkDestroySemaphore(deviceObj->device, frames[i].drawingCompleteSemaphore, NULL);
+		vkDestroyFence(deviceObj->device, frames[i].fence, NULL);
+	}
+}
+
+void VulkanRenderer::destroyRecordingThreads()
 {
-	for each (VulkanDrawable* drawableObj in drawableList)
 	{
-		drawableObj->destroySynchronizationObjects();
+		std::lock_guard<std::mutex> lock(recordMutex);
+		recordQuit = true;
+	}
+	recordStart.notify_all();
+
+	for each (RecordingThread* recorder in recordingThreads)
+	{
+		recorder->thread.join();
+		for (uint32_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++) {
+			vkDestroyCommandPool(deviceObj->device, recorder->cmdPools[j], NULL);
+		}
+		delete recorder;
 	}
+	recordingThreads.clear();
 }
 
 void VulkanRenderer::destroyDepthBuffer()
 {
 	vkDestroyImageView(deviceObj->device, Depth.view, NULL);
+	resourceTracker.unregisterImage(Depth.image);
 	vkDestroyImage(deviceObj->device, Depth.image, NULL);
-	vkFreeMemory(deviceObj->device, Depth.mem, NULL);
+	deviceObj->memoryAllocator->free(&Depth.mem);
 }
 
 void VulkanRenderer::destroyCommandBuffer()
 {
-	VkCommandBuffer cmdBufs[] = { cmdDepthImage, cmdVertexBuffer, cmdTexture };
-	vkFreeCommandBuffers(deviceObj->device, cmdPool, sizeof(cmdBufs)/sizeof(VkCommandBuffer), cmdBufs);
+	vkFreeCommandBuffers(deviceObj->device, cmdPool, 1, &cmdInit);
+	cmdInit = VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::destroyStagingRing()
+{
+	stagingRing.destroy();
+}
+
+void VulkanRenderer::destroyProfiler()
+{
+	profiler.destroy();
 }
 
 void VulkanRenderer::destroyCommandPool()
@@ -1018,7 +1318,7 @@ void VulkanRenderer::buildSwapChainAndDepthImage()
 	deviceObj->getDeviceQueue();
 
 	// Create swapchain and get the color image
-	swapChainObj->createSwapChain(cmdDepthImage);
+	swapChainObj->createSwapChain(cmdInit);
 	
 	// Create the depth image
 	createDepthImage();
@@ -1026,15 +1326,73 @@ void VulkanRenderer::buildSwapChainAndDepthImage()
 
 void VulkanRenderer::createVertexBuffer()
 {
-	CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &cmdVertexBuffer);
-	CommandBufferMgr::beginCommandBuffer(cmdVertexBuffer);
+	// Lay out the instances on a grid fitting in the unit cube
+	std::vector<InstanceData> instances(INSTANCE_COUNT);
+	uint32_t gridSize	= (uint32_t)ceil(pow((double)INSTANCE_COUNT, 1.0 / 3.0));
+	float cellSize		= 2.0f / (gridSize > 0 ? gridSize : 1);
+	for (uint32_t i = 0; i < instances.size(); i++) {
+		glm::vec3 cell((float)(i % gridSize), (float)((i / gridSize) % gridSize), (float)(i / (gridSize * gridSize)));
+		glm::vec3 position = glm::vec3(-1.0f) + (cell + glm::vec3(0.5f)) * cellSize;
+		instances[i].model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cellSize * 0.4f));
+	}
 
 	for each (VulkanDrawable* drawableObj in drawableList)
 	{
-		drawableObj->createVertexBuffer(geometryData, sizeof(geometryData), sizeof(geometryData[0]), false);
+		drawableObj->createVertexBuffer(geometryData, sizeof(geometryData), sizeof(geometryData[0]));
+		if (!instances.empty()) {
+			drawableObj->createInstanceBuffer(instances.data(), (uint32_t)instances.size());
+		}
 	}
-	CommandBufferMgr::endCommandBuffer(cmdVertexBuffer);
-	CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &cmdVertexBuffer);
+
+	// Submit the staged copies of the buffers, unless the init batch does
+	if (!initBatchRecording) {
+		stagingRing.submit();
+	}
+}
+
+void VulkanRenderer::createDeviceLocalBuffer(VkBufferUsageFlags usage, const void* data, VkDeviceSize size, VkBuffer* buffer, MemoryAllocation* mem)
+{
+	VkResult  result;
+	bool  pass;
+
+	// Create the Buffer resourece metadata information
+	VkBufferCreateInfo bufInfo		= {};
+	bufInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufInfo.pNext					= NULL;
+	bufInfo.usage					= usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufInfo.size					= size;
+	bufInfo.queueFamilyIndexCount	= 0;
+	bufInfo.pQueueFamilyIndices		= NULL;
+	bufInfo.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
+	bufInfo.flags					= 0;
+
+	result = vkCreateBuffer(deviceObj->device, &bufInfo, NULL, buffer);
+	assert(result == VK_SUCCESS);
+
+	VkMemoryRequirements memRqrmnt;
+	vkGetBufferMemoryRequirements(deviceObj->device, *buffer, &memRqrmnt);
+
+	// On unified memory and resizable BAR heaps the host writes the 
+	// device local memory directly, the staging copy is not needed.
+	uint32_t mappableTypeIndex;
+	if (deviceObj->isDeviceLocalMemoryMappable(memRqrmnt.memoryTypeBits, &mappableTypeIndex)) {
+		pass = deviceObj->memoryAllocator->allocateBufferMemory(*buffer,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, mem,
+			1u << mappableTypeIndex);
+		assert(pass);
+
+		memcpy(mem->pMapped, data, (size_t)size);
+		return;
+	}
+
+	// Otherwise the buffer lives in video memory not visible to the host
+	pass = deviceObj->memoryAllocator->allocateBufferMemory(*buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, mem);
+	assert(pass);
+
+	stagingRing.copyToBuffer(*buffer, 0, data, size);
+
+	// Make the copied data visible to the stages reading the buffer
+	stagingRing.finishBufferUpload(*buffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void VulkanRenderer::createShaders()
@@ -1046,7 +1404,7 @@ void VulkanRenderer::createShaders()
 	size_t sizeVert, sizeFrag;
 
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
-	vertShaderCode = readFile("./../Texture.vert", &sizeVert);
+	vertShaderCode = readFile(INSTANCE_COUNT > 0 ? "./../TextureInstanced.vert" : "./../Texture.vert", &sizeVert);
 	fragShaderCode = readFile("./../Texture.frag", &sizeFrag);
 	
 	shaderObj.buildShader((const char*)vertShaderCode, (const char*)fragShaderCode);
@@ -1076,28 +1434,58 @@ void VulkanRenderer::createDescriptors()
 
 void VulkanRenderer::createPipelineStateManagement()
 {
+	// Host layout of the vertex and instance buffers: the position and the 
+	// texture coordinates per vertex, the model matrix columns per instance.
+	std::vector<VkVertexInputAttributeDescription> hostAttributes(6);
+	hostAttributes[0].binding	= VERTEX_INPUT_VERTEX_BINDING;
+	hostAttributes[0].location	= 0;
+	hostAttributes[0].format	= VK_FORMAT_R32G32B32A32_SFLOAT;
+	hostAttributes[0].offset	= offsetof(VertexWithUV, x);
+	hostAttributes[1].binding	= VERTEX_INPUT_VERTEX_BINDING;
+	hostAttributes[1].location	= 1;
+	hostAttributes[1].format	= VK_FORMAT_R32G32_SFLOAT;
+	hostAttributes[1].offset	= offsetof(VertexWithUV, u);
+
+	// A mat4 attribute consumes four locations, one vec4 per column
+	for (uint32_t i = 0; i < 4; i++) {
+		hostAttributes[2 + i].binding	= VERTEX_INPUT_INSTANCE_BINDING;
+		hostAttributes[2 + i].location	= 2 + i;
+		hostAttributes[2 + i].format	= VK_FORMAT_R32G32B32A32_SFLOAT;
+		hostAttributes[2 + i].offset	= (uint32_t)(offsetof(InstanceData, model) + sizeof(glm::vec4) * i);
+	}
+
 	for each (VulkanDrawable* drawableObj in drawableList)
 	{
 		// Use the descriptor layout and create the pipeline layout.
 		drawableObj->createPipelineLayout();
+
+		// Interpret the vertex and instance buffers as the vertex shader expects
+		drawableObj->createVertexInput(hostAttributes, shaderObj.reflection);
 	}
 
 	pipelineObj.createPipelineCache();
 
+	// Compile the pipelines of all the drawables in one batch
 	const bool depthPresent = true;
-	for each (VulkanDrawable* drawableObj in drawableList)
-	{
-		VkPipeline* pipeline = (VkPipeline*)malloc(sizeof(VkPipeline));
-		if (pipelineObj.createPipeline(drawableObj, pipeline, &shaderObj, depthPresent))
-		{
-			pipelineList.push_back(pipeline);
-			drawableObj->setPipeline(pipeline);
-		}
-		else
-		{
-			free(pipeline);
-			pipeline = NULL;
+	std::vector<PipelineDescription> descriptions(drawableList.size());
+	for (uint32_t i = 0; i < drawableList.size(); i++) {
+		descriptions[i].drawableObj		= drawableList[i];
+		descriptions[i].shaderObj		= &shaderObj;
+		descriptions[i].includeDepth	= depthPresent;
+		descriptions[i].includeVi		= true;
+		descriptions[i].pipeline		= VK_NULL_HANDLE;
+	}
+	application->jobSystem.wait(pipelineObj.createPipelines(descriptions));
+
+	for (uint32_t i = 0; i < drawableList.size(); i++) {
+		if (descriptions[i].pipeline == VK_NULL_HANDLE) {
+			continue;
 		}
+
+		VkPipeline* pipeline = (VkPipeline*)malloc(sizeof(VkPipeline));
+		*pipeline = descriptions[i].pipeline;
+		pipelineList.push_back(pipeline);
+		drawableList[i]->setPipeline(pipeline);
 	}
 }
 
@@ -1105,71 +1493,11 @@ void VulkanRenderer::setImageLayout(VkImage image, VkImageAspectFlags aspectMask
 {
 	// Dependency on cmd
 	assert(cmd != VK_NULL_HANDLE);
-	
-	// The deviceObj->queue must be initialized
-	assert(deviceObj->queue != VK_NULL_HANDLE);
-
-	VkImageMemoryBarrier imgMemoryBarrier = {};
-	imgMemoryBarrier.sType			= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imgMemoryBarrier.pNext			= NULL;
-	imgMemoryBarrier.srcAccessMask	= 0;
-	imgMemoryBarrier.dstAccessMask	= 0;
-	imgMemoryBarrier.oldLayout		= oldImageLayout;
-	imgMemoryBarrier.newLayout		= newImageLayout;
-	imgMemoryBarrier.image			= image;
-	imgMemoryBarrier.subresourceRange = subresourceRange;
-
-	if (oldImageLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-		imgMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
-
-	// Source layouts (old)
-	switch (oldImageLayout)
-	{
-		case VK_IMAGE_LAYOUT_UNDEFINED:
-			imgMemoryBarrier.srcAccessMask = 0;
-			break;
-		case VK_IMAGE_LAYOUT_PREINITIALIZED:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-			break;
-		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			break;
-		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
-
-	switch (newImageLayout)
-	{
-	// Ensure that anything that was copying from this image has completed
-	// An image in this layout can only be used as the destination operand of the commands
-	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-		imgMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		break;
-
-	// Ensure any Copy or CPU writes to image are flushed
-	// An image in this layout can only be used as a read-only shader resource
-	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-		imgMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imgMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		break;
-
-	// An image in this layout can only be used as a framebuffer color attachment
-	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-		imgMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-		break;
-
-	// An image in this layout can only be used as a framebuffer depth/stencil attachment
-	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-		imgMemoryBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		break;
-	}
-
-	VkPipelineStageFlags srcStages	= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	VkPipelineStageFlags destStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 
-	vkCmdPipelineBarrier(cmd, srcStages, destStages, 0, 0, NULL, 0, NULL, 1, &imgMemoryBarrier);
+	// Single transition, the stages and accesses are derived from the layouts
+	VulkanBarrierBuilder barriers;
+	barriers.transitionImage(image, subresourceRange, oldImageLayout, newImageLayout);
+	barriers.flush(cmd);
 }
 
 // Destroy each pipeline object existing in the renderer
@@ -1177,7 +1505,7 @@ void VulkanRenderer::destroyPipeline()
 {
 	for each (VkPipeline* pipeline in pipelineList)
 	{
-		vkDestroyPipeline(deviceObj->device, *pipeline, NULL);
+		pipelineObj.releasePipeline(*pipeline);
 		free(pipeline);
 	}
 	pipelineList.clear();
@@ -0,0 +1,196 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanResourceTracker.h"
+
+// Accesses which modify the memory, a read after a write needs a barrier
+static const VkAccessFlags WRITE_ACCESS_MASK =	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+												VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+												VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// Same layout and no write on either side, the subresource is ready for the use
+static bool needsBarrier(const VulkanResourceTracker::SubresourceState& state, VkImageLayout layout, VkAccessFlags accessMask)
+{
+	return (state.layout != layout) || ((state.accessMask | accessMask) & WRITE_ACCESS_MASK);
+}
+
+static bool isSameState(const VulkanResourceTracker::SubresourceState& a, const VulkanResourceTracker::SubresourceState& b)
+{
+	return a.layout == b.layout && a.stageMask == b.stageMask && a.accessMask == b.accessMask;
+}
+
+VulkanResourceTracker::VulkanResourceTracker()
+{
+}
+
+VulkanResourceTracker::~VulkanResourceTracker()
+{
+}
+
+void VulkanResourceTracker::registerImage(VkImage image, uint32_t mipLevels, uint32_t layerCount, VkImageLayout initialLayout)
+{
+	SubresourceState initialState;
+	initialState.layout				= initialLayout;
+	initialState.stageMask			= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	initialState.accessMask			= 0;
+
+	// The host writes of a preinitialized image must be made visible
+	if (initialLayout == VK_IMAGE_LAYOUT_PREINITIALIZED) {
+		initialState.stageMask		= VK_PIPELINE_STAGE_HOST_BIT;
+		initialState.accessMask		= VK_ACCESS_HOST_WRITE_BIT;
+	}
+
+	ImageState& state	= images[image];
+	state.mipLevels		= mipLevels;
+	state.layerCount	= layerCount;
+	state.subresources.assign(mipLevels * layerCount, initialState);
+}
+
+void VulkanResourceTracker::unregisterImage(VkImage image)
+{
+	images.erase(image);
+}
+
+VulkanResourceTracker::ImageState& VulkanResourceTracker::getImageState(VkImage image)
+{
+	std::map<VkImage, ImageState>::iterator it = images.find(image);
+	assert(it != images.end());
+	return it->second;
+}
+
+void VulkanResourceTracker::useImage(VulkanBarrierBuilder& barriers, VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+	VkPipelineStageFlags shaderStages)
+{
+	VkPipelineStageFlags	stageMask;
+	VkAccessFlags			accessMask;
+	VulkanBarrierBuilder::getLayoutStageAccess(layout, false, shaderStages, &stageMask, &accessMask);
+
+	useImage(barriers, image, subresourceRange, layout, stageMask, accessMask);
+}
+
+void VulkanResourceTracker::useImage(VulkanBarrierBuilder& barriers, VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+	VkPipelineStageFlags stageMask, VkAccessFlags accessMask)
+{
+	ImageState& state		= getImageState(image);
+	uint32_t levelCount		= (subresourceRange.levelCount == VK_REMAINING_MIP_LEVELS) ? state.mipLevels - subresourceRange.baseMipLevel : subresourceRange.levelCount;
+	uint32_t layerCount		= (subresourceRange.layerCount == VK_REMAINING_ARRAY_LAYERS) ? state.layerCount - subresourceRange.baseArrayLayer : subresourceRange.layerCount;
+	assert(subresourceRange.baseMipLevel + levelCount <= state.mipLevels);
+	assert(subresourceRange.baseArrayLayer + layerCount <= state.layerCount);
+
+	// The barriers cover whole mip levels when their layers share the same
+	// state, adjacent mip levels in the same state are merged together.
+	bool					pending = false;
+	SubresourceState		pendingState;
+	VkImageSubresourceRange	pendingRange;
+
+	for (uint32_t level = subresourceRange.baseMipLevel; level < subresourceRange.baseMipLevel + levelCount; level++) {
+		SubresourceState* levelStates	= &state.subresources[level * state.layerCount + subresourceRange.baseArrayLayer];
+		bool uniform					= true;
+		for (uint32_t i = 1; i < layerCount; i++) {
+			uniform = uniform && isSameState(levelStates[i], levelStates[0]);
+		}
+
+		if (uniform) {
+			if (needsBarrier(levelStates[0], layout, accessMask)) {
+				if (pending && isSameState(pendingState, levelStates[0]) && pendingRange.baseMipLevel + pendingRange.levelCount == level) {
+					pendingRange.levelCount++;
+				}
+				else {
+					if (pending) {
+						barriers.imageBarrier(image, pendingRange, pendingState.layout, layout,
+							pendingState.stageMask, pendingState.accessMask & WRITE_ACCESS_MASK, stageMask, accessMask);
+					}
+					pending						= true;
+					pendingState				= levelStates[0];
+					pendingRange				= subresourceRange;
+					pendingRange.baseMipLevel	= level;
+					pendingRange.levelCount		= 1;
+					pendingRange.layerCount		= layerCount;
+				}
+			}
+		}
+		else {
+			// The layers of the level went through different uses
+			for (uint32_t i = 0; i < layerCount; i++) {
+				if (needsBarrier(levelStates[i], layout, accessMask)) {
+					VkImageSubresourceRange layerRange	= subresourceRange;
+					layerRange.baseMipLevel				= level;
+					layerRange.levelCount				= 1;
+					layerRange.baseArrayLayer			= subresourceRange.baseArrayLayer + i;
+					layerRange.layerCount				= 1;
+					barriers.imageBarrier(image, layerRange, levelStates[i].layout, layout,
+						levelStates[i].stageMask, levelStates[i].accessMask & WRITE_ACCESS_MASK, stageMask, accessMask);
+				}
+			}
+		}
+
+		// A barrier waits for all the previous uses, the state restarts from this use. Without
+		// barrier the readers accumulate, the next write must wait for all of them.
+		for (uint32_t i = 0; i < layerCount; i++) {
+			if (needsBarrier(levelStates[i], layout, accessMask)) {
+				levelStates[i].stageMask	= stageMask;
+				levelStates[i].accessMask	= accessMask;
+			}
+			else {
+				levelStates[i].stageMask	|= stageMask;
+				levelStates[i].accessMask	|= accessMask;
+			}
+			levelStates[i].layout		= layout;
+		}
+	}
+
+	if (pending) {
+		barriers.imageBarrier(image, pendingRange, pendingState.layout, layout,
+			pendingState.stageMask, pendingState.accessMask & WRITE_ACCESS_MASK, stageMask, accessMask);
+	}
+}
+
+void VulkanResourceTracker::setImageState(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout layout,
+	VkPipelineStageFlags stageMask, VkAccessFlags accessMask)
+{
+	ImageState& state		= getImageState(image);
+	uint32_t levelCount		= (subresourceRange.levelCount == VK_REMAINING_MIP_LEVELS) ? state.mipLevels - subresourceRange.baseMipLevel : subresourceRange.levelCount;
+	uint32_t layerCount		= (subresourceRange.layerCount == VK_REMAINING_ARRAY_LAYERS) ? state.layerCount - subresourceRange.baseArrayLayer : subresourceRange.layerCount;
+
+	for (uint32_t level = subresourceRange.baseMipLevel; level < subresourceRange.baseMipLevel + levelCount; level++) {
+		for (uint32_t layer = subresourceRange.baseArrayLayer; layer < subresourceRange.baseArrayLayer + layerCount; layer++) {
+			SubresourceState& current	= state.subresources[level * state.layerCount + layer];
+			current.layout				= layout;
+			current.stageMask			= stageMask;
+			current.accessMask			= accessMask;
+		}
+	}
+}
+
+const VulkanResourceTracker::SubresourceState& VulkanResourceTracker::getSubresourceState(VkImage image, uint32_t mipLevel, uint32_t arrayLayer)
+{
+	ImageState& state = getImageState(image);
+	return state.subresources[mipLevel * state.layerCount + arrayLayer];
+}
+
+VkImageLayout VulkanResourceTracker::getImageLayout(VkImage image, uint32_t mipLevel, uint32_t arrayLayer)
+{
+	return getSubresourceState(image, mipLevel, arrayLayer).layout;
+}
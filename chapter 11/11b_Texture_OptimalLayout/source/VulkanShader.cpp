@@ -26,22 +26,104 @@
 #include "VulkanShader.h"
 #include "VulkanApplication.h"
 #include "VulkanDevice.h"
+#include "Wrappers.h"
 
+// Compiler options of GLSLtoSPV(), part of the shader cache key
+#define GLSL_DEFAULT_VERSION	100
+#define GLSL_MESSAGES			(EShMessages)(EShMsgSpvRules | EShMsgVulkanRules)
+
+VulkanShader::VulkanShader()
+{
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+	glslangInitialized = false;
+#endif
+	memset(shaderStages, 0, sizeof(shaderStages));
+}
+
+ShaderStagesSnapshot& ShaderStagesSnapshot::operator=(const ShaderStagesSnapshot& other)
+{
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		stages[i]			= other.stages[i];
+		specializations[i]	= other.specializations[i];
+	}
+	bindSpecializations();
+	return *this;
+}
+
+void ShaderStagesSnapshot::bindSpecializations()
+{
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		if (!stages[i].pSpecializationInfo) {
+			continue;
+		}
+
+		specializations[i].info.pMapEntries	= specializations[i].entries.data();
+		specializations[i].info.pData		= specializations[i].data.data();
+		stages[i].pSpecializationInfo		= &specializations[i].info;
+	}
+}
+
+ShaderStagesSnapshot VulkanShader::getStagesSnapshot() const
+{
+	ShaderStagesSnapshot shader;
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		shader.stages[i]			= shaderStages[i];
+		shader.specializations[i]	= specializations[i];
+	}
+	shader.bindSpecializations();
+	return shader;
+}
+
+uint32_t VulkanShader::getStageIndex(VkShaderStageFlagBits stage)
+{
+	assert(stage == VK_SHADER_STAGE_VERTEX_BIT || stage == VK_SHADER_STAGE_FRAGMENT_BIT);
+	return (stage == VK_SHADER_STAGE_VERTEX_BIT) ? 0 : 1;
+}
+
+void VulkanShader::setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantID, bool value)
+{
+	setSpecializationConstant<VkBool32>(stage, constantID, value ? VK_TRUE : VK_FALSE);
+}
+
+void VulkanShader::clearSpecializationConstants(VkShaderStageFlagBits stage)
+{
+	uint32_t stageIndex = getStageIndex(stage);
+	specializations[stageIndex].entries.clear();
+	specializations[stageIndex].data.clear();
+	updateSpecializationInfo(stageIndex);
+}
+
+void VulkanShader::updateSpecializationInfo(uint32_t stageIndex)
+{
+	SpecializationConstants& constants = specializations[stageIndex];
+	if (constants.entries.empty()) {
+		shaderStages[stageIndex].pSpecializationInfo = NULL;
+		return;
+	}
+
+	// The vectors may have been reallocated, refresh the pointers
+	constants.info.mapEntryCount	= (uint32_t)constants.entries.size();
+	constants.info.pMapEntries		= constants.entries.data();
+	constants.info.dataSize			= constants.data.size();
+	constants.info.pData			= constants.data.data();
+	shaderStages[stageIndex].pSpecializationInfo = &constants.info;
+}
 
 void VulkanShader::buildShaderModuleWithSPV(uint32_t *vertShaderText, size_t vertexSPVSize, uint32_t *fragShaderText, size_t fragmentSPVSize)
 {
 	VulkanDevice* deviceObj = VulkanApplication::GetInstance()->deviceObj;
 
 	VkResult  result;
+	bool  retVal;
 
 	// Fill in the control structure to push the necessary
 	// details of the shader.
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].pNext = NULL;
-	shaderStages[0].pSpecializationInfo = NULL;
 	shaderStages[0].flags = 0;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
 	shaderStages[0].pName = "main";
+	updateSpecializationInfo(0);
 
 	VkShaderModuleCreateInfo moduleCreateInfo;
 	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -49,22 +131,31 @@ void VulkanShader::buildShaderModuleWithSPV(uint32_t *vertShaderText, size_t ver
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = vertexSPVSize;
 	moduleCreateInfo.pCode = vertShaderText;
+
+	reflection.clear();
+	retVal = reflection.reflect(vertShaderText, vertexSPVSize, VK_SHADER_STAGE_VERTEX_BIT);
+	assert(retVal);
+
 	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[0].module);
 	assert(result == VK_SUCCESS);
 
 	std::vector<unsigned int> fragSPV;
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].pNext = NULL;
-	shaderStages[1].pSpecializationInfo = NULL;
 	shaderStages[1].flags = 0;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	shaderStages[1].pName = "main";
+	updateSpecializationInfo(1);
 
 	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	moduleCreateInfo.pNext = NULL;
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = fragmentSPVSize;
 	moduleCreateInfo.pCode = fragShaderText;
+
+	retVal = reflection.reflect(fragShaderText, fragmentSPVSize, VK_SHADER_STAGE_FRAGMENT_BIT);
+	assert(retVal);
+
 	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[1].module);
 	assert(result == VK_SUCCESS);
 }
@@ -74,6 +165,13 @@ void VulkanShader::destroyShaders()
 	VulkanDevice* deviceObj = VulkanApplication::GetInstance()->deviceObj;
 	vkDestroyShaderModule(deviceObj->device, shaderStages[0].module, NULL);
 	vkDestroyShaderModule(deviceObj->device, shaderStages[1].module, NULL);
+
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+	if (glslangInitialized) {
+		glslang::FinalizeProcess();
+		glslangInitialized = false;
+	}
+#endif
 }
 
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
@@ -93,14 +191,12 @@ void VulkanShader::buildShader(const char *vertShaderText, const char *fragShade
 	std::vector<unsigned int> vertexSPV;
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].pNext = NULL;
-	shaderStages[0].pSpecializationInfo = NULL;
 	shaderStages[0].flags = 0;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
 	shaderStages[0].pName = "main";
+	updateSpecializationInfo(0);
 
-	glslang::InitializeProcess();
-
-	retVal = GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vertShaderText, vertexSPV);
+	retVal = GLSLtoSPVCached(VK_SHADER_STAGE_VERTEX_BIT, vertShaderText, vertexSPV);
 	assert(retVal);
 
 	VkShaderModuleCreateInfo moduleCreateInfo;
@@ -109,18 +205,23 @@ void VulkanShader::buildShader(const char *vertShaderText, const char *fragShade
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = vertexSPV.size() * sizeof(unsigned int);
 	moduleCreateInfo.pCode = vertexSPV.data();
+
+	reflection.clear();
+	retVal = reflection.reflect(vertexSPV.data(), vertexSPV.size() * sizeof(unsigned int), VK_SHADER_STAGE_VERTEX_BIT);
+	assert(retVal);
+
 	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[0].module);
 	assert(result == VK_SUCCESS);
 
 	std::vector<unsigned int> fragSPV;
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].pNext = NULL;
-	shaderStages[1].pSpecializationInfo = NULL;
 	shaderStages[1].flags = 0;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	shaderStages[1].pName = "main";
+	updateSpecializationInfo(1);
 
-	retVal = GLSLtoSPV(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderText, fragSPV);
+	retVal = GLSLtoSPVCached(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderText, fragSPV);
 	assert(retVal);
 
 	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -128,10 +229,72 @@ void VulkanShader::buildShader(const char *vertShaderText, const char *fragShade
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = fragSPV.size() * sizeof(unsigned int);
 	moduleCreateInfo.pCode = fragSPV.data();
+
+	retVal = reflection.reflect(fragSPV.data(), fragSPV.size() * sizeof(unsigned int), VK_SHADER_STAGE_FRAGMENT_BIT);
+	assert(retVal);
+
 	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[1].module);
 	assert(result == VK_SUCCESS);
+}
 
-	glslang::FinalizeProcess();
+std::string VulkanShader::getCacheFileName(const VkShaderStageFlagBits shaderType, const char *pshader)
+{
+	TBuiltInResource Resources;
+	memset(&Resources, 0, sizeof(Resources));
+	initializeResources(Resources);
+
+	const uint32_t version		= SHADER_CACHE_VERSION;
+	const uint32_t glslVersion	= GLSL_DEFAULT_VERSION;
+	const uint32_t messages		= GLSL_MESSAGES;
+
+	// FNV-1a of the source, stage and everything configuring the compiler
+	struct { const void* data; size_t size; } keyParts[] = {
+		{ &version,		sizeof(version) },
+		{ &shaderType,	sizeof(shaderType) },
+		{ &glslVersion,	sizeof(glslVersion) },
+		{ &messages,	sizeof(messages) },
+		{ &Resources,	sizeof(Resources) },
+		{ pshader,		strlen(pshader) },
+	};
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint32_t i = 0; i < sizeof(keyParts) / sizeof(keyParts[0]); i++) {
+		const uint8_t* byte = (const uint8_t*)keyParts[i].data;
+		for (size_t j = 0; j < keyParts[i].size; j++) {
+			hash = (hash ^ byte[j]) * 1099511628211ULL;
+		}
+	}
+
+	std::stringstream fileName;
+	fileName << SHADER_CACHE_FILE_PREFIX << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+	return fileName.str();
+}
+
+bool VulkanShader::GLSLtoSPVCached(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv)
+{
+	const std::string fileName = getCacheFileName(shaderType, pshader);
+
+	// Hit: a whole number of words starting with the SPIR-V magic number
+	size_t size = 0;
+	uint32_t* code = (uint32_t*)readFile(fileName.c_str(), &size);
+	if (code && size >= sizeof(uint32_t) && size % sizeof(uint32_t) == 0 && code[0] == 0x07230203) {
+		spirv.assign(code, code + size / sizeof(uint32_t));
+		free(code);
+		return true;
+	}
+	free(code);
+
+	// Miss: compile and store the result for the next run
+	if (!glslangInitialized) {
+		glslang::InitializeProcess();
+		glslangInitialized = true;
+	}
+
+	if (!GLSLtoSPV(shaderType, pshader, spirv)) {
+		return false;
+	}
+
+	writeFile(fileName.c_str(), spirv.data(), spirv.size() * sizeof(unsigned int));
+	return true;
 }
 
 //
@@ -146,7 +309,7 @@ bool VulkanShader::GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char
 	initializeResources(Resources);
 
 	// Enable SPIR-V and Vulkan rules when parsing GLSL
-	EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+	EShMessages messages = GLSL_MESSAGES;
 
 	EShLanguage stage = getLanguage(shaderType);
 	glslang::TShader* shader = new glslang::TShader(stage);
@@ -154,7 +317,7 @@ bool VulkanShader::GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char
 	shaderStrings[0] = pshader;
 	shader->setStrings(shaderStrings, 1);
 
-	if (!shader->parse(&Resources, 100, false, messages)) {
+	if (!shader->parse(&Resources, GLSL_DEFAULT_VERSION, false, messages)) {
 		puts(shader->getInfoLog());
 		puts(shader->getInfoDebugLog());
 		return false;
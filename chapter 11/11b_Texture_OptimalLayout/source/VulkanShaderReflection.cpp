@@ -0,0 +1,505 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanShaderReflection.h"
+
+// SPIR-V opcodes, decorations and storage classes used by the reflection
+#define SPIRV_MAGIC_NUMBER				0x07230203
+#define SPIRV_OP_DECORATE				71
+#define SPIRV_OP_MEMBER_DECORATE		72
+#define SPIRV_OP_TYPE_INT				21
+#define SPIRV_OP_TYPE_FLOAT				22
+#define SPIRV_OP_TYPE_VECTOR			23
+#define SPIRV_OP_TYPE_MATRIX			24
+#define SPIRV_OP_TYPE_IMAGE				25
+#define SPIRV_OP_TYPE_SAMPLER			26
+#define SPIRV_OP_TYPE_SAMPLED_IMAGE		27
+#define SPIRV_OP_TYPE_ARRAY				28
+#define SPIRV_OP_TYPE_RUNTIME_ARRAY		29
+#define SPIRV_OP_TYPE_STRUCT			30
+#define SPIRV_OP_TYPE_POINTER			32
+#define SPIRV_OP_CONSTANT				43
+#define SPIRV_OP_SPEC_CONSTANT			50
+#define SPIRV_OP_VARIABLE				59
+
+#define SPIRV_DECORATION_BLOCK			2
+#define SPIRV_DECORATION_BUFFER_BLOCK	3
+#define SPIRV_DECORATION_ARRAY_STRIDE	6
+#define SPIRV_DECORATION_MATRIX_STRIDE	7
+#define SPIRV_DECORATION_BUILT_IN		11
+#define SPIRV_DECORATION_LOCATION		30
+#define SPIRV_DECORATION_BINDING		33
+#define SPIRV_DECORATION_DESCRIPTOR_SET	34
+#define SPIRV_DECORATION_OFFSET			35
+
+#define SPIRV_STORAGE_UNIFORM_CONSTANT	0
+#define SPIRV_STORAGE_INPUT				1
+#define SPIRV_STORAGE_UNIFORM			2
+#define SPIRV_STORAGE_PUSH_CONSTANT		9
+#define SPIRV_STORAGE_STORAGE_BUFFER	12
+
+#define SPIRV_DIM_BUFFER				5
+#define SPIRV_DIM_SUBPASS_DATA			6
+
+// Result id of the module with the instruction declaring it and its decorations
+struct SpirvId {
+	uint32_t				opcode;
+	std::vector<uint32_t>	operands;		// Operands following the result id
+	uint32_t				set;
+	uint32_t				binding;
+	uint32_t				location;
+	uint32_t				arrayStride;
+	bool					builtIn;
+	bool					bufferBlock;
+	std::vector<uint32_t>	memberOffsets;
+	std::vector<uint32_t>	memberMatrixStrides;
+};
+
+// The id is in the bound of the module and its declaration has at least operandCount operands
+static bool isValidId(const std::vector<SpirvId>& ids, uint32_t id, size_t operandCount)
+{
+	return id < ids.size() && ids[id].operands.size() >= operandCount;
+}
+
+// Length of an array type, 0 if the length is not a constant. The default
+// value of a specialization constant is used, the pipeline may override it.
+static uint32_t getArrayLength(const std::vector<SpirvId>& ids, const SpirvId& arrayType)
+{
+	// Array operands: element type, length. Constant operands: result type, value
+	if (arrayType.operands.size() < 2 || !isValidId(ids, arrayType.operands[1], 2)) {
+		return 0;
+	}
+
+	const SpirvId& length = ids[arrayType.operands[1]];
+	if (length.opcode != SPIRV_OP_CONSTANT && length.opcode != SPIRV_OP_SPEC_CONSTANT) {
+		return 0;
+	}
+	return length.operands[1];
+}
+
+// Size in bytes of a type laid out in a buffer block, 0 if the type is not valid
+static uint32_t getTypeSize(const std::vector<SpirvId>& ids, uint32_t typeId, uint32_t matrixStride)
+{
+	if (!isValidId(ids, typeId, 1)) {
+		return 0;
+	}
+
+	const SpirvId& type = ids[typeId];
+	switch (type.opcode) {
+	case SPIRV_OP_TYPE_INT:
+	case SPIRV_OP_TYPE_FLOAT:
+		return type.operands[0] / 8;
+
+	case SPIRV_OP_TYPE_VECTOR:
+		return type.operands.size() < 2 ? 0 : getTypeSize(ids, type.operands[0], 0) * type.operands[1];
+
+	case SPIRV_OP_TYPE_MATRIX:
+		return type.operands.size() < 2 ? 0 : (matrixStride ? matrixStride : getTypeSize(ids, type.operands[0], 0)) * type.operands[1];
+
+	case SPIRV_OP_TYPE_ARRAY:
+		return type.arrayStride * getArrayLength(ids, type);
+
+	case SPIRV_OP_TYPE_STRUCT: {
+		// The last byte used by any member
+		uint32_t size = 0;
+		for (uint32_t i = 0; i < type.operands.size() && i < type.memberOffsets.size(); i++) {
+			uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+			size = std::max(size, type.memberOffsets[i] + getTypeSize(ids, type.operands[i], stride));
+		}
+		return size;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+// Vertex attribute format of a scalar or vector input, VK_FORMAT_UNDEFINED if not supported
+static VkFormat getInputFormat(const std::vector<SpirvId>& ids, uint32_t typeId)
+{
+	if (!isValidId(ids, typeId, 1)) {
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	const SpirvId& type = ids[typeId];
+	uint32_t componentCount = 1;
+	const SpirvId* component = &type;
+	if (type.opcode == SPIRV_OP_TYPE_VECTOR) {
+		if (type.operands.size() < 2 || !isValidId(ids, type.operands[0], 1)) {
+			return VK_FORMAT_UNDEFINED;
+		}
+		component		= &ids[type.operands[0]];
+		componentCount	= type.operands[1];
+	}
+
+	// Only the 32 bits components are used as vertex inputs, integer types also carry their signedness
+	if (component->operands[0] != 32 || componentCount < 1 || componentCount > 4 ||
+		(component->opcode == SPIRV_OP_TYPE_INT && component->operands.size() < 2)) {
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	static const VkFormat floatFormats[]	= { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	static const VkFormat intFormats[]		= { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	static const VkFormat uintFormats[]		= { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+	if (component->opcode == SPIRV_OP_TYPE_FLOAT) {
+		return floatFormats[componentCount - 1];
+	}
+	if (component->opcode == SPIRV_OP_TYPE_INT) {
+		return component->operands[1] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+VulkanShaderReflection::VulkanShaderReflection()
+{
+}
+
+VulkanShaderReflection::~VulkanShaderReflection()
+{
+}
+
+void VulkanShaderReflection::clear()
+{
+	bindings.clear();
+	pushConstantRanges.clear();
+	inputs.clear();
+}
+
+bool VulkanShaderReflection::reflect(const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stage)
+{
+	// Header: magic number, version, generator, id bound, schema
+	size_t wordCount = codeSize / sizeof(uint32_t);
+	if (!code || wordCount < 5 || code[0] != SPIRV_MAGIC_NUMBER) {
+		return false;
+	}
+
+	std::vector<SpirvId> ids(code[3]);
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		ids[i].opcode		= 0;
+		ids[i].set			= 0;
+		ids[i].binding		= UINT32_MAX;
+		ids[i].location		= UINT32_MAX;
+		ids[i].arrayStride	= 0;
+		ids[i].builtIn		= false;
+		ids[i].bufferBlock	= false;
+	}
+
+	// Gather the types, variables, constants and decorations
+	std::vector<uint32_t> variables;
+	for (size_t word = 5; word < wordCount; ) {
+		uint32_t opcode					= code[word] & 0xFFFF;
+		uint32_t instructionWordCount	= code[word] >> 16;
+		if (instructionWordCount == 0 || word + instructionWordCount > wordCount) {
+			return false;
+		}
+		const uint32_t* operands	= &code[word + 1];
+		uint32_t operandCount		= instructionWordCount - 1;
+		word += instructionWordCount;
+
+		switch (opcode) {
+		case SPIRV_OP_DECORATE: {
+			if (operandCount < 2 || operands[0] >= ids.size()) {
+				break;
+			}
+			SpirvId& target = ids[operands[0]];
+			switch (operands[1]) {
+			case SPIRV_DECORATION_BUFFER_BLOCK:		target.bufferBlock	= true; break;
+			case SPIRV_DECORATION_BUILT_IN:			target.builtIn		= true; break;
+			case SPIRV_DECORATION_ARRAY_STRIDE:		if (operandCount > 2) target.arrayStride	= operands[2]; break;
+			case SPIRV_DECORATION_LOCATION:			if (operandCount > 2) target.location		= operands[2]; break;
+			case SPIRV_DECORATION_BINDING:			if (operandCount > 2) target.binding		= operands[2]; break;
+			case SPIRV_DECORATION_DESCRIPTOR_SET:	if (operandCount > 2) target.set			= operands[2]; break;
+			}
+			break;
+		}
+
+		case SPIRV_OP_MEMBER_DECORATE: {
+			if (operandCount < 4 || operands[0] >= ids.size()) {
+				break;
+			}
+			SpirvId& target = ids[operands[0]];
+			uint32_t member = operands[1];
+			if (operands[2] == SPIRV_DECORATION_OFFSET) {
+				target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1), 0);
+				target.memberOffsets[member] = operands[3];
+			}
+			else if (operands[2] == SPIRV_DECORATION_MATRIX_STRIDE) {
+				target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1), 0);
+				target.memberMatrixStrides[member] = operands[3];
+			}
+			break;
+		}
+
+		case SPIRV_OP_TYPE_INT:
+		case SPIRV_OP_TYPE_FLOAT:
+		case SPIRV_OP_TYPE_VECTOR:
+		case SPIRV_OP_TYPE_MATRIX:
+		case SPIRV_OP_TYPE_IMAGE:
+		case SPIRV_OP_TYPE_SAMPLER:
+		case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+		case SPIRV_OP_TYPE_ARRAY:
+		case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+		case SPIRV_OP_TYPE_STRUCT:
+		case SPIRV_OP_TYPE_POINTER: {
+			// Result id first, then the operands
+			if (operandCount < 1 || operands[0] >= ids.size()) {
+				return false;
+			}
+			ids[operands[0]].opcode = opcode;
+			ids[operands[0]].operands.assign(operands + 1, operands + operandCount);
+			break;
+		}
+
+		case SPIRV_OP_CONSTANT:
+		case SPIRV_OP_SPEC_CONSTANT:
+		case SPIRV_OP_VARIABLE: {
+			// Result type first, then the result id
+			if (operandCount < 3 || operands[1] >= ids.size()) {
+				return false;
+			}
+			ids[operands[1]].opcode = opcode;
+			ids[operands[1]].operands.assign(operands, operands + operandCount);
+			ids[operands[1]].operands.erase(ids[operands[1]].operands.begin() + 1);
+			if (opcode == SPIRV_OP_VARIABLE) {
+				variables.push_back(operands[1]);
+			}
+			break;
+		}
+		}
+	}
+
+	VulkanShaderReflection stageReflection;
+	for each (uint32_t variableId in variables)
+	{
+		// Variable operands: pointer type, storage class. Pointer 
+		// operands: storage class, pointee type. The ids were not
+		// checked while gathering, types may be declared later.
+		const SpirvId& variable = ids[variableId];
+		if (!isValidId(ids, variable.operands[0], 2) || ids[variable.operands[0]].opcode != SPIRV_OP_TYPE_POINTER) {
+			return false;
+		}
+		uint32_t storageClass	= variable.operands[1];
+		uint32_t typeId			= ids[variable.operands[0]].operands[1];
+		if (!isValidId(ids, typeId, 0)) {
+			return false;
+		}
+
+		if (storageClass == SPIRV_STORAGE_INPUT) {
+			if (stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn || variable.location == UINT32_MAX) {
+				continue;
+			}
+
+			// A matrix uses one location per column
+			ReflectedInput input;
+			input.location = variable.location;
+			if (ids[typeId].opcode == SPIRV_OP_TYPE_MATRIX) {
+				if (ids[typeId].operands.size() < 2) {
+					return false;
+				}
+				input.format = getInputFormat(ids, ids[typeId].operands[0]);
+				for (uint32_t column = 0; column < ids[typeId].operands[1]; column++) {
+					stageReflection.inputs.push_back(input);
+					input.location++;
+				}
+			}
+			else {
+				input.format = getInputFormat(ids, typeId);
+				stageReflection.inputs.push_back(input);
+			}
+			assert(input.format != VK_FORMAT_UNDEFINED);
+			continue;
+		}
+
+		if (storageClass == SPIRV_STORAGE_PUSH_CONSTANT) {
+			VkPushConstantRange range;
+			range.stageFlags	= stage;
+			range.offset		= 0;
+			range.size			= getTypeSize(ids, typeId, 0);
+			stageReflection.pushConstantRanges.push_back(range);
+			continue;
+		}
+
+		if (storageClass != SPIRV_STORAGE_UNIFORM_CONSTANT && storageClass != SPIRV_STORAGE_UNIFORM &&
+			storageClass != SPIRV_STORAGE_STORAGE_BUFFER) {
+			continue;
+		}
+
+		// Arrays of descriptors, the runtime sized arrays count as one descriptor
+		ReflectedBinding binding;
+		binding.set				= variable.set;
+		binding.binding			= variable.binding;
+		binding.descriptorCount	= 1;
+		binding.stageFlags		= stage;
+		if (ids[typeId].opcode == SPIRV_OP_TYPE_ARRAY) {
+			binding.descriptorCount	= getArrayLength(ids, ids[typeId]);
+			typeId					= ids[typeId].operands[0];
+			if (binding.descriptorCount == 0) {
+				return false;
+			}
+		}
+		else if (ids[typeId].opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+			if (ids[typeId].operands.empty()) {
+				return false;
+			}
+			typeId					= ids[typeId].operands[0];
+		}
+		if (!isValidId(ids, typeId, 0)) {
+			return false;
+		}
+
+		const SpirvId& type = ids[typeId];
+		if (storageClass == SPIRV_STORAGE_STORAGE_BUFFER) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		else if (storageClass == SPIRV_STORAGE_UNIFORM) {
+			binding.descriptorType = type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+		else if (type.opcode == SPIRV_OP_TYPE_SAMPLED_IMAGE) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		}
+		else if (type.opcode == SPIRV_OP_TYPE_SAMPLER) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+		}
+		else if (type.opcode == SPIRV_OP_TYPE_IMAGE) {
+			// Image operands: sampled type, dim, depth, arrayed, multisampled, sampled
+			if (type.operands.size() < 6) {
+				return false;
+			}
+			uint32_t dim		= type.operands[1];
+			uint32_t sampled	= type.operands[5];
+			if (dim == SPIRV_DIM_SUBPASS_DATA) {
+				binding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			else if (dim == SPIRV_DIM_BUFFER) {
+				binding.descriptorType = (sampled == 2) ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			else {
+				binding.descriptorType = (sampled == 2) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+		}
+		else {
+			continue;
+		}
+
+		assert(binding.binding != UINT32_MAX);
+		stageReflection.bindings.push_back(binding);
+	}
+
+	return merge(stageReflection);
+}
+
+bool VulkanShaderReflection::merge(const VulkanShaderReflection& other)
+{
+	// The same binding may be used by several stages, its declarations must agree
+	for each (const ReflectedBinding& otherBinding in other.bindings)
+	{
+		bool found = false;
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			if (bindings[i].set != otherBinding.set || bindings[i].binding != otherBinding.binding) {
+				continue;
+			}
+			if (bindings[i].descriptorType != otherBinding.descriptorType ||
+				bindings[i].descriptorCount != otherBinding.descriptorCount) {
+				return false;
+			}
+			bindings[i].stageFlags |= otherBinding.stageFlags;
+			found = true;
+		}
+		if (!found) {
+			bindings.push_back(otherBinding);
+		}
+	}
+
+	// Ranges of the same stages are widened
+	for each (const VkPushConstantRange& otherRange in other.pushConstantRanges)
+	{
+		bool found = false;
+		for (uint32_t i = 0; i < pushConstantRanges.size(); i++) {
+			if (pushConstantRanges[i].stageFlags == otherRange.stageFlags) {
+				pushConstantRanges[i].size = std::max(pushConstantRanges[i].size, otherRange.size);
+				found = true;
+			}
+		}
+		if (!found) {
+			pushConstantRanges.push_back(otherRange);
+		}
+	}
+
+	// An input location is declared once, its format must agree if merged again
+	for each (const ReflectedInput& otherInput in other.inputs)
+	{
+		bool found = false;
+		for (uint32_t i = 0; i < inputs.size(); i++) {
+			if (inputs[i].location != otherInput.location) {
+				continue;
+			}
+			if (inputs[i].format != otherInput.format) {
+				return false;
+			}
+			found = true;
+		}
+		if (!found) {
+			inputs.push_back(otherInput);
+		}
+	}
+	std::sort(inputs.begin(), inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b) { return a.location < b.location; });
+	return true;
+}
+
+void VulkanShaderReflection::getDescriptorSetLayoutBindings(uint32_t set, bool dynamicUniformBuffers, std::vector<VkDescriptorSetLayoutBinding>& layoutBindings) const
+{
+	layoutBindings.clear();
+	for each (const ReflectedBinding& binding in bindings)
+	{
+		if (binding.set != set) {
+			continue;
+		}
+
+		VkDescriptorSetLayoutBinding layoutBinding;
+		layoutBinding.binding				= binding.binding;
+		layoutBinding.descriptorType		= binding.descriptorType;
+		layoutBinding.descriptorCount		= binding.descriptorCount;
+		layoutBinding.stageFlags			= binding.stageFlags;
+		layoutBinding.pImmutableSamplers	= NULL;
+		if (dynamicUniformBuffers && binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+			layoutBinding.descriptorType	= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		}
+		layoutBindings.push_back(layoutBinding);
+	}
+
+	std::sort(layoutBindings.begin(), layoutBindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+}
+
+uint32_t VulkanShaderReflection::getDescriptorSetCount() const
+{
+	uint32_t count = 0;
+	for each (const ReflectedBinding& binding in bindings)
+	{
+		count = std::max(count, binding.set + 1);
+	}
+	return count;
+}
@@ -0,0 +1,476 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanStagingRing.h"
+#include "VulkanApplication.h"
+#include "VulkanDevice.h"
+#include "VulkanProfiler.h"
+#include "Wrappers.h"
+
+// Round up the value to the next multiple of alignment
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VulkanStagingRing::VulkanStagingRing()
+{
+	deviceObj			= VulkanApplication::GetInstance()->deviceObj;
+	profiler			= NULL;
+	cmdPool				= VK_NULL_HANDLE;
+	acquireCmdPool		= VK_NULL_HANDLE;
+	dedicatedQueue		= false;
+	buffer				= VK_NULL_HANDLE;
+	ringSize			= 0;
+	head				= 0;
+	tail				= 0;
+	copyAlignment		= 16;
+	bandAlignment		= 4;
+	recording.cmdBuf		= VK_NULL_HANDLE;
+	recording.acquireCmdBuf	= VK_NULL_HANDLE;
+	recording.semaphore		= VK_NULL_HANDLE;
+	recording.fence			= VK_NULL_HANDLE;
+	recording.end			= 0;
+	memset(&memory, 0, sizeof(memory));
+}
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+}
+
+void VulkanStagingRing::create(VkDeviceSize size)
+{
+	if (buffer != VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkResult  result;
+
+	// Record the copies for the transfer only queue if the device has one
+	dedicatedQueue	= deviceObj->hasTransferQueue();
+	bandAlignment	= 4;
+
+	// The bands of the images split over several copies start at multiples of the
+	// transfer granularity, counted in texel blocks of up to 4 rows for the compressed 
+	// formats. A (0,0,0) granularity only allows whole mip levels to be copied, the
+	// big images could not be split: the uploads go through the graphics queue then.
+	if (dedicatedQueue) {
+		const VkExtent3D& granularity = deviceObj->queueFamilyProps[deviceObj->transferQueueIndex].minImageTransferGranularity;
+		if (granularity.height == 0) {
+			dedicatedQueue = false;
+		}
+		else {
+			bandAlignment = 4 * granularity.height;
+		}
+	}
+
+	// Command buffers are short lived and reused once their fence is signaled
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.pNext				= NULL;
+	cmdPoolInfo.queueFamilyIndex	= dedicatedQueue ? deviceObj->transferQueueIndex : deviceObj->graphicsQueueWithPresentIndex;
+	cmdPoolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	result = vkCreateCommandPool(deviceObj->device, &cmdPoolInfo, NULL, &cmdPool);
+	assert(result == VK_SUCCESS);
+
+	// The acquire barriers are executed by the graphics queue
+	if (dedicatedQueue) {
+		cmdPoolInfo.queueFamilyIndex = deviceObj->graphicsQueueWithPresentIndex;
+		result = vkCreateCommandPool(deviceObj->device, &cmdPoolInfo, NULL, &acquireCmdPool);
+		assert(result == VK_SUCCESS);
+	}
+
+	VkBufferCreateInfo bufInfo		= {};
+	bufInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufInfo.pNext					= NULL;
+	bufInfo.usage					= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufInfo.size					= size;
+	bufInfo.queueFamilyIndexCount	= 0;
+	bufInfo.pQueueFamilyIndices		= NULL;
+	bufInfo.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
+	bufInfo.flags					= 0;
+
+	result = vkCreateBuffer(deviceObj->device, &bufInfo, NULL, &buffer);
+	assert(result == VK_SUCCESS);
+
+	bool pass = deviceObj->memoryAllocator->allocateBufferMemory(buffer,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, &memory);
+	assert(pass);
+
+	ringSize		= size;
+	head			= 0;
+	tail			= 0;
+	copyAlignment	= std::max<VkDeviceSize>(16, deviceObj->gpuProps.limits.optimalBufferCopyOffsetAlignment);
+}
+
+void VulkanStagingRing::destroy()
+{
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	submit();
+	waitIdle();
+
+	for each (Submission submission in freeList) {
+		vkFreeCommandBuffers(deviceObj->device, cmdPool, 1, &submission.cmdBuf);
+		vkDestroyFence(deviceObj->device, submission.fence, NULL);
+		if (submission.acquireCmdBuf != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(deviceObj->device, acquireCmdPool, 1, &submission.acquireCmdBuf);
+			vkDestroySemaphore(deviceObj->device, submission.semaphore, NULL);
+		}
+	}
+	freeList.clear();
+
+	vkDestroyCommandPool(deviceObj->device, cmdPool, NULL);
+	if (acquireCmdPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(deviceObj->device, acquireCmdPool, NULL);
+		acquireCmdPool = VK_NULL_HANDLE;
+	}
+	vkDestroyBuffer(deviceObj->device, buffer, NULL);
+	deviceObj->memoryAllocator->free(&memory);
+
+	cmdPool		= VK_NULL_HANDLE;
+	buffer		= VK_NULL_HANDLE;
+	ringSize	= 0;
+}
+
+VkCommandBuffer VulkanStagingRing::getCommandBuffer()
+{
+	if (recording.cmdBuf != VK_NULL_HANDLE) {
+		return recording.cmdBuf;
+	}
+
+	VkResult  result;
+
+	// Reuse a retired command buffer and its fence, or create a new pair
+	if (!freeList.empty()) {
+		recording = freeList.back();
+		freeList.pop_back();
+
+		result = vkResetCommandBuffer(recording.cmdBuf, 0);
+		assert(result == VK_SUCCESS);
+	}
+	else {
+		CommandBufferMgr::allocCommandBuffer(&deviceObj->device, cmdPool, &recording.cmdBuf);
+		recording.acquireCmdBuf	= VK_NULL_HANDLE;
+		recording.semaphore		= VK_NULL_HANDLE;
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType	= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.pNext	= NULL;
+		fenceInfo.flags	= 0;
+
+		result = vkCreateFence(deviceObj->device, &fenceInfo, NULL, &recording.fence);
+		assert(result == VK_SUCCESS);
+	}
+
+	VkCommandBufferBeginInfo cmdBufInfo = {};
+	cmdBufInfo.sType			= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBufInfo.pNext			= NULL;
+	cmdBufInfo.flags			= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBufInfo.pInheritanceInfo	= NULL;
+	CommandBufferMgr::beginCommandBuffer(recording.cmdBuf, &cmdBufInfo);
+
+	return recording.cmdBuf;
+}
+
+VulkanBarrierBuilder& VulkanStagingRing::getCopyBarriers()
+{
+	// The barriers are recorded in the current command buffer
+	getCommandBuffer();
+	return copyBarriers;
+}
+
+void VulkanStagingRing::copyToBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	const uint8_t* src		= (const uint8_t*)data;
+	VkDeviceSize maxChunk	= ringSize / 2;
+
+	// Split the data in chunks which fit in the ring
+	for (VkDeviceSize done = 0; done < size;) {
+		VkDeviceSize chunkSize	= std::min(size - done, maxChunk);
+		VkDeviceSize offset		= allocate(chunkSize, copyAlignment);
+		memcpy(memory.pMapped + offset, src + done, (size_t)chunkSize);
+
+		VkBufferCopy copy	= {};
+		copy.srcOffset		= offset;
+		copy.dstOffset		= dstOffset + done;
+		copy.size			= chunkSize;
+		vkCmdCopyBuffer(getCommandBuffer(), buffer, dstBuffer, 1, &copy);
+
+		done += chunkSize;
+	}
+}
+
+void VulkanStagingRing::copyToImage(VkImage image, const void* data, VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions)
+{
+	const uint8_t* src		= (const uint8_t*)data;
+	VkDeviceSize maxChunk	= ringSize / 2;
+
+	for (size_t i = 0; i < regions.size(); i++) {
+		const VkBufferImageCopy& region = regions[i];
+		assert(region.bufferRowLength == 0 && region.bufferImageHeight == 0);
+
+		VkDeviceSize regionEnd	= (i + 1 < regions.size()) ? regions[i + 1].bufferOffset : size;
+		VkDeviceSize regionSize	= regionEnd - region.bufferOffset;
+
+		if (regionSize <= maxChunk) {
+			VkDeviceSize offset = allocate(regionSize, copyAlignment);
+			memcpy(memory.pMapped + offset, src + region.bufferOffset, (size_t)regionSize);
+
+			ImageCopy copy				= { image, region };
+			copy.region.bufferOffset	= offset;
+			getCommandBuffer();
+			imageCopies.push_back(copy);
+			continue;
+		}
+
+		// The region is too big for the ring, copy it in bands of rows. The band height is
+		// a multiple of bandAlignment, which respects the compressed block sizes and the
+		// transfer granularity; the last band ends with the image.
+		assert(region.imageExtent.depth == 1);
+		VkDeviceSize rowSize	= regionSize / region.imageExtent.height;
+		uint32_t bandRows		= (uint32_t)(maxChunk / rowSize) / bandAlignment * bandAlignment;
+		assert(bandRows > 0);
+
+		for (uint32_t row = 0; row < region.imageExtent.height; row += bandRows) {
+			uint32_t rows			= std::min(bandRows, region.imageExtent.height - row);
+			VkDeviceSize bandSize	= rows * rowSize;
+			VkDeviceSize offset		= allocate(bandSize, copyAlignment);
+			memcpy(memory.pMapped + offset, src + region.bufferOffset + row * rowSize, (size_t)bandSize);
+
+			ImageCopy copy				= { image, region };
+			copy.region.bufferOffset		= offset;
+			copy.region.imageOffset.y		= region.imageOffset.y + row;
+			copy.region.imageExtent.height	= rows;
+			getCommandBuffer();
+			imageCopies.push_back(copy);
+		}
+	}
+}
+
+void VulkanStagingRing::finishBufferUpload(VkBuffer dstBuffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+{
+	// The copies are recorded in the current command buffer
+	getCommandBuffer();
+
+	// Same queue, make the copied data visible to the stages reading it
+	if (!dedicatedQueue) {
+		finishBarriers.bufferBarrier(dstBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, dstStageMask, dstAccessMask);
+		return;
+	}
+
+	// Release the buffer from the transfer queue family, the matching 
+	// acquire is recorded for the graphics queue at submission.
+	finishBarriers.bufferBarrier(dstBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		deviceObj->transferQueueIndex, deviceObj->graphicsQueueWithPresentIndex);
+	acquireBarriers.bufferBarrier(dstBuffer, dstStageMask, 0, dstStageMask, dstAccessMask,
+		deviceObj->transferQueueIndex, deviceObj->graphicsQueueWithPresentIndex);
+}
+
+void VulkanStagingRing::finishImageUpload(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout newLayout,
+	VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+{
+	const VkImageLayout oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+	// The copies are recorded in the current command buffer
+	getCommandBuffer();
+
+	// Same queue, transition the layout after the copies
+	if (!dedicatedQueue) {
+		finishBarriers.imageBarrier(image, subresourceRange, oldLayout, newLayout,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, dstStageMask, dstAccessMask);
+		return;
+	}
+
+	// Release the image from the transfer queue family, the layout transition
+	// is performed once by the release and acquire pair. The matching acquire 
+	// is recorded for the graphics queue at submission.
+	finishBarriers.imageBarrier(image, subresourceRange, oldLayout, newLayout,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		deviceObj->transferQueueIndex, deviceObj->graphicsQueueWithPresentIndex);
+	acquireBarriers.imageBarrier(image, subresourceRange, oldLayout, newLayout,
+		dstStageMask, 0, dstStageMask, dstAccessMask,
+		deviceObj->transferQueueIndex, deviceObj->graphicsQueueWithPresentIndex);
+}
+
+void VulkanStagingRing::submit()
+{
+	if (recording.cmdBuf == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// Transition the images to the transfer layout at once, record the 
+	// queued image copies and then the barriers of the finished uploads.
+	uint32_t uploadScope = PROFILER_INVALID_SCOPE;
+	if (profiler && !dedicatedQueue && !imageCopies.empty()) {
+		uploadScope = profiler->beginUploadScope(recording.cmdBuf, "TextureUpload");
+	}
+
+	copyBarriers.flush(recording.cmdBuf);
+	for each (ImageCopy copy in imageCopies) {
+		vkCmdCopyBufferToImage(recording.cmdBuf, buffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+	}
+	imageCopies.clear();
+	finishBarriers.flush(recording.cmdBuf);
+
+	if (profiler) {
+		profiler->endScope(recording.cmdBuf, uploadScope);
+	}
+
+	CommandBufferMgr::endCommandBuffer(recording.cmdBuf);
+
+	VkSubmitInfo submitInfo			= {};
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext				= NULL;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &recording.cmdBuf;
+
+	if (!dedicatedQueue || acquireBarriers.empty()) {
+		// The fence is used to retire the ring space, no wait here
+		CommandBufferMgr::submitCommandBuffer(dedicatedQueue ? deviceObj->transferQueue : deviceObj->queue,
+			&recording.cmdBuf, &submitInfo, recording.fence);
+	}
+	else {
+		VkResult  result;
+
+		if (recording.acquireCmdBuf == VK_NULL_HANDLE) {
+			CommandBufferMgr::allocCommandBuffer(&deviceObj->device, acquireCmdPool, &recording.acquireCmdBuf);
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreInfo.pNext = NULL;
+			semaphoreInfo.flags = 0;
+
+			result = vkCreateSemaphore(deviceObj->device, &semaphoreInfo, NULL, &recording.semaphore);
+			assert(result == VK_SUCCESS);
+		}
+
+		// The copies signal the semaphore on the transfer queue. Submitted without
+		// a fence and without waiting, the graphics submission below tracks them.
+		submitInfo.signalSemaphoreCount	= 1;
+		submitInfo.pSignalSemaphores	= &recording.semaphore;
+		result = vkQueueSubmit(deviceObj->transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		assert(result == VK_SUCCESS);
+
+		// The graphics queue waits for the copies and acquires the resources
+		VkCommandBufferBeginInfo cmdBufInfo = {};
+		cmdBufInfo.sType			= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufInfo.pNext			= NULL;
+		cmdBufInfo.flags			= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		cmdBufInfo.pInheritanceInfo	= NULL;
+
+		result = vkResetCommandBuffer(recording.acquireCmdBuf, 0);
+		assert(result == VK_SUCCESS);
+		CommandBufferMgr::beginCommandBuffer(recording.acquireCmdBuf, &cmdBufInfo);
+		VkPipelineStageFlags waitStageMask = acquireBarriers.getDstStageMask();
+		acquireBarriers.flush(recording.acquireCmdBuf);
+		CommandBufferMgr::endCommandBuffer(recording.acquireCmdBuf);
+
+		VkSubmitInfo acquireInfo			= {};
+		acquireInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.pNext					= NULL;
+		acquireInfo.waitSemaphoreCount		= 1;
+		acquireInfo.pWaitSemaphores			= &recording.semaphore;
+		acquireInfo.pWaitDstStageMask		= &waitStageMask;
+		acquireInfo.commandBufferCount		= 1;
+		acquireInfo.pCommandBuffers			= &recording.acquireCmdBuf;
+
+		// The graphics submission completes after the copies, its fence retires the ring space
+		CommandBufferMgr::submitCommandBuffer(deviceObj->queue, &recording.acquireCmdBuf, &acquireInfo, recording.fence);
+	}
+
+	recording.end = head;
+	inFlight.push_back(recording);
+	recording.cmdBuf	= VK_NULL_HANDLE;
+	recording.fence		= VK_NULL_HANDLE;
+}
+
+void VulkanStagingRing::waitIdle()
+{
+	while (!inFlight.empty()) {
+		retire(true);
+	}
+}
+
+VkDeviceSize VulkanStagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	assert(size <= ringSize);
+
+	retire(false);
+	while (true) {
+		// Place the range after the head, or at the start of the ring if it does not fit before the end
+		VkDeviceSize base	= head - head % ringSize;
+		VkDeviceSize offset	= alignUp(head % ringSize, alignment);
+		if (offset + size > ringSize) {
+			base	+= ringSize;
+			offset	= 0;
+		}
+
+		if (base + offset + size - tail <= ringSize) {
+			head = base + offset + size;
+			return offset;
+		}
+
+		// The ring is full, submit the pending copies and 
+		// wait for the oldest submission to release its space.
+		if (inFlight.empty()) {
+			submit();
+		}
+		retire(true);
+	}
+}
+
+void VulkanStagingRing::retire(bool wait)
+{
+	bool waited = false;
+	while (!inFlight.empty()) {
+		Submission submission = inFlight.front();
+
+		if (vkGetFenceStatus(deviceObj->device, submission.fence) != VK_SUCCESS) {
+			// Block on the oldest submission only
+			if (!wait || waited) {
+				break;
+			}
+
+			VkResult result = vkWaitForFences(deviceObj->device, 1, &submission.fence, VK_TRUE, UINT64_MAX);
+			assert(result == VK_SUCCESS);
+			waited = true;
+		}
+
+		vkResetFences(deviceObj->device, 1, &submission.fence);
+		tail = submission.end;
+		inFlight.erase(inFlight.begin());
+		freeList.push_back(submission);
+	}
+
+	// Nothing is pending, restart from the beginning of the ring
+	if (inFlight.empty() && recording.cmdBuf == VK_NULL_HANDLE) {
+		head = 0;
+		tail = 0;
+	}
+}
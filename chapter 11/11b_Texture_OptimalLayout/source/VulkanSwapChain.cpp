@@ -197,6 +197,13 @@ void VulkanSwapChain::getSupportedFormats()
 
 void VulkanSwapChain::intializeSwapChain()
 {
+	// Headless mode has no surface, any graphics queue will do
+	if (appObj->isHeadless) {
+		rendererObj->getDevice()->graphicsQueueWithPresentIndex = rendererObj->getDevice()->graphicsQueueIndex;
+		scPublicVars.format = HEADLESS_COLOR_FORMAT;
+		return;
+	}
+
 	// Querying swapchain extensions
 	createSwapChainExtensions();
 
@@ -218,6 +225,15 @@ void VulkanSwapChain::intializeSwapChain()
 
 void VulkanSwapChain::createSwapChain(const VkCommandBuffer& cmd)
 {
+	// Headless mode renders in the offscreen images of the renderer size
+	if (appObj->isHeadless) {
+		scPrivateVars.swapChainExtent.width		= rendererObj->width;
+		scPrivateVars.swapChainExtent.height	= rendererObj->height;
+		createOffscreenColorImages();
+		createColorImageView(cmd);
+		return;
+	}
+
 	// use extensions and get the surface capabilities, present mode
 	getSurfaceCapabilitiesAndPresentMode();
 
@@ -344,6 +360,76 @@ void VulkanSwapChain::createSwapChainColorImages()
 	}
 }
 
+void VulkanSwapChain::createOffscreenColorImages()
+{
+	VulkanDevice* deviceObj = rendererObj->getDevice();
+	VkResult  result;
+
+	VkImageCreateInfo imageInfo		= {};
+	imageInfo.sType					= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.pNext					= NULL;
+	imageInfo.imageType				= VK_IMAGE_TYPE_2D;
+	imageInfo.format				= scPublicVars.format;
+	imageInfo.extent.width			= scPrivateVars.swapChainExtent.width;
+	imageInfo.extent.height			= scPrivateVars.swapChainExtent.height;
+	imageInfo.extent.depth			= 1;
+	imageInfo.mipLevels				= 1;
+	imageInfo.arrayLayers			= 1;
+	imageInfo.samples				= VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling				= VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.queueFamilyIndexCount	= 0;
+	imageInfo.pQueueFamilyIndices	= NULL;
+	imageInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+	// Transfer source allows reading back the rendered frames
+	imageInfo.usage					= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.flags					= 0;
+
+	scPublicVars.swapchainImageCount = HEADLESS_IMAGE_COUNT;
+	scPrivateVars.swapchainImages.resize(scPublicVars.swapchainImageCount);
+	scPrivateVars.offscreenMemory.resize(scPublicVars.swapchainImageCount);
+
+	for (uint32_t i = 0; i < scPublicVars.swapchainImageCount; i++) {
+		result = vkCreateImage(deviceObj->device, &imageInfo, NULL, &scPrivateVars.swapchainImages[i]);
+		assert(result == VK_SUCCESS);
+
+		bool pass = deviceObj->memoryAllocator->allocateImageMemory(scPrivateVars.swapchainImages[i],
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, &scPrivateVars.offscreenMemory[i]);
+		assert(pass);
+	}
+	scPublicVars.currentColorBuffer = 0;
+}
+
+VkResult VulkanSwapChain::acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t* imageIndex)
+{
+	if (appObj->isHeadless) {
+		*imageIndex = (*imageIndex + 1) % scPublicVars.swapchainImageCount;
+		return VK_SUCCESS;
+	}
+
+	return fpAcquireNextImageKHR(rendererObj->getDevice()->device, scPublicVars.swapChain,
+		UINT64_MAX, presentCompleteSemaphore, VK_NULL_HANDLE, imageIndex);
+}
+
+VkResult VulkanSwapChain::queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore drawingCompleteSemaphore)
+{
+	if (appObj->isHeadless) {
+		return VK_SUCCESS;
+	}
+
+	VkPresentInfoKHR present = {};
+	present.sType				= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	present.pNext				= NULL;
+	present.swapchainCount		= 1;
+	present.pSwapchains			= &scPublicVars.swapChain;
+	present.pImageIndices		= &imageIndex;
+	present.pWaitSemaphores		= &drawingCompleteSemaphore;
+	present.waitSemaphoreCount	= 1;
+	present.pResults			= NULL;
+
+	return fpQueuePresentKHR(queue, &present);
+}
+
 void VulkanSwapChain::createColorImageView(const VkCommandBuffer& cmd)
 {
 	VkResult  result;
@@ -386,6 +472,17 @@ void VulkanSwapChain::destroySwapChain()
 	for (uint32_t i = 0; i < scPublicVars.swapchainImageCount; i++) {
 		vkDestroyImageView(deviceObj->device, scPublicVars.colorBuffer[i].view, NULL);
 	}
+
+	// The offscreen images are owned by the application
+	if (appObj->isHeadless) {
+		for (uint32_t i = 0; i < scPublicVars.swapchainImageCount; i++) {
+			vkDestroyImage(deviceObj->device, scPrivateVars.swapchainImages[i], NULL);
+			deviceObj->memoryAllocator->free(&scPrivateVars.offscreenMemory[i]);
+		}
+		scPrivateVars.swapchainImages.clear();
+		scPrivateVars.offscreenMemory.clear();
+		return;
+	}
 	
 	if (!appObj->isResizing) {
 		// This piece code will only executes at application shutdown.
@@ -0,0 +1,107 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanTextureLoader.h"
+
+VulkanTextureLoader::VulkanTextureLoader()
+{
+	jobSystem	= NULL;
+	quit		= false;
+}
+
+VulkanTextureLoader::~VulkanTextureLoader()
+{
+}
+
+void VulkanTextureLoader::create(VulkanJobSystem* jobSystemObj)
+{
+	jobSystem	= jobSystemObj;
+	quit		= false;
+}
+
+void VulkanTextureLoader::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+
+	// The jobs not started yet skip the decoding
+	for each (JobHandle job in jobs)
+	{
+		jobSystem->wait(job);
+	}
+	jobs.clear();
+
+	// Drop what was not uploaded
+	for each (Request request in decoded)
+	{
+		delete request.image;
+	}
+	decoded.clear();
+}
+
+void VulkanTextureLoader::load(const char* filename, TextureData* texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
+{
+	Request request;
+	request.filename		= filename;
+	request.texture			= texture;
+	request.imageUsageFlags	= imageUsageFlags;
+	request.format			= format;
+	request.image			= NULL;
+
+	assert(jobSystem);
+	// Decoding takes long, the threads helping while they wait must not pick it
+	jobs.push_back(jobSystem->scheduleBackground([this, request] { decode(request); }));
+}
+
+bool VulkanTextureLoader::fetchDecoded(Request* request)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (decoded.empty()) {
+		return false;
+	}
+
+	*request = decoded.front();
+	decoded.pop_front();
+	return true;
+}
+
+void VulkanTextureLoader::decode(Request request)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (quit) {
+			return;
+		}
+	}
+
+	// Read and decode the file outside of the lock
+	request.image = new gli::texture2D(gli::load(request.filename.c_str()));
+	assert(!request.image->empty());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	decoded.push_back(request);
+}
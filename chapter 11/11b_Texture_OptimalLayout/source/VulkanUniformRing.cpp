@@ -0,0 +1,136 @@
+/*
+* Learning Vulkan - ISBN: 9781786469809
+*
+* Author: Parminder Singh, parminder.vulkan@gmail.com
+* Linkedin: https://www.linkedin.com/in/parmindersingh18
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VulkanUniformRing.h"
+#include "VulkanApplication.h"
+#include "VulkanDevice.h"
+
+// Round up the value to the next multiple of alignment
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VulkanUniformRing::VulkanUniformRing()
+{
+	deviceObj	= VulkanApplication::GetInstance()->deviceObj;
+	buffer		= VK_NULL_HANDLE;
+	frameSize	= 0;
+	alignment	= 1;
+	coherent	= true;
+	frameBase	= 0;
+	frameOffset	= 0;
+	memset(&memory, 0, sizeof(memory));
+}
+
+VulkanUniformRing::~VulkanUniformRing()
+{
+}
+
+void VulkanUniformRing::create(uint32_t frameCount, VkDeviceSize size)
+{
+	if (buffer != VK_NULL_HANDLE) {
+		return;
+	}
+
+	// Dynamic offsets must be multiple of minUniformBufferOffsetAlignment, for
+	// non-coherent memory the flushed ranges must be aligned to the atom size.
+	const VkPhysicalDeviceLimits& limits = deviceObj->gpuProps.limits;
+	alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, limits.nonCoherentAtomSize);
+	frameSize = alignUp(size, alignment);
+
+	VkBufferCreateInfo bufInfo		= {};
+	bufInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufInfo.pNext					= NULL;
+	bufInfo.usage					= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufInfo.size					= frameSize * frameCount;
+	bufInfo.queueFamilyIndexCount	= 0;
+	bufInfo.pQueueFamilyIndices		= NULL;
+	bufInfo.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
+	bufInfo.flags					= 0;
+
+	VkResult result = vkCreateBuffer(deviceObj->device, &bufInfo, NULL, &buffer);
+	assert(result == VK_SUCCESS);
+
+	// Host visible memory is required, coherent memory saves the flushes
+	bool pass = deviceObj->memoryAllocator->allocateBufferMemory(buffer,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &memory);
+	assert(pass);
+
+	coherent	= (deviceObj->memoryProperties.memoryTypes[memory.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	frameBase	= 0;
+	frameOffset	= 0;
+}
+
+void VulkanUniformRing::destroy()
+{
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(deviceObj->device, buffer, NULL);
+	deviceObj->memoryAllocator->free(&memory);
+	buffer = VK_NULL_HANDLE;
+}
+
+void VulkanUniformRing::beginFrame(uint32_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	frameBase	= frameIndex * frameSize;
+	frameOffset	= 0;
+}
+
+uint32_t VulkanUniformRing::push(const void* data, VkDeviceSize size)
+{
+	VkDeviceSize offset;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		offset		= frameBase + frameOffset;
+		frameOffset	+= alignUp(size, alignment);
+	}
+
+	// The frame region is sized for the worst case of the scene
+	assert(offset + size <= frameBase + frameSize);
+
+	memcpy(memory.pMapped + offset, data, (size_t)size);
+	return (uint32_t)offset;
+}
+
+void VulkanUniformRing::flush()
+{
+	if (coherent || frameOffset == 0) {
+		return;
+	}
+
+	VkMappedMemoryRange range	= {};
+	range.sType					= VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.pNext					= NULL;
+	range.memory				= memory.memory;
+	range.offset				= memory.offset + frameBase;
+	range.size					= frameOffset;
+
+	VkResult result = vkFlushMappedMemoryRanges(deviceObj->device, 1, &range);
+	assert(result == VK_SUCCESS);
+}
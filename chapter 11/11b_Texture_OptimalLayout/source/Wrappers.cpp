@@ -101,8 +101,12 @@ void CommandBufferMgr::submitCommandBuffer(const VkQueue& queue, const VkCommand
 		result = vkQueueSubmit(queue, 1, inSubmitInfo, fence);
 		assert(!result);
 
-		result = vkQueueWaitIdle(queue);
-		assert(!result);
+		// When a fence is supplied the caller is responsible for the 
+		// synchronization, otherwise wait for the queue to finish.
+		if (fence == VK_NULL_HANDLE) {
+			result = vkQueueWaitIdle(queue);
+			assert(!result);
+		}
 		return;
 	}
 
@@ -121,8 +125,10 @@ void CommandBufferMgr::submitCommandBuffer(const VkQueue& queue, const VkCommand
 	result = vkQueueSubmit(queue, 1, &submitInfo, fence);
 	assert(!result);
 
-	result = vkQueueWaitIdle(queue);
-	assert(!result);
+	if (fence == VK_NULL_HANDLE) {
+		result = vkQueueWaitIdle(queue);
+		assert(!result);
+	}
 }
 
 // PPM parser implementation
@@ -187,6 +193,13 @@ void* readFile(const char *spvFileName, size_t *fileSize) {
 	fseek(fp, 0L, SEEK_END);
 	size = ftell(fp);
 
+	// An empty file, e.g. a cache left truncated, has no contents to return
+	if (size <= 0) {
+		fclose(fp);
+		*fileSize = 0;
+		return NULL;
+	}
+
 	fseek(fp, 0L, SEEK_SET);
 
 	void* spvShader = malloc(size+1); // Plus for NULL character '\0'
@@ -200,3 +213,30 @@ void* readFile(const char *spvFileName, size_t *fileSize) {
 	return spvShader;
 }
 
+bool writeFile(const char *fileName, const void* data, size_t size) {
+
+	const std::string tempFileName = std::string(fileName) + ".tmp";
+	FILE* fp = fopen(tempFileName.c_str(), "wb");
+	if (!fp) {
+		return false;
+	}
+
+	bool written = fwrite(data, 1, size, fp) == size;
+	written = (fflush(fp) == 0) && written;
+	fclose(fp);
+	if (!written) {
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	bool renamed = MoveFileExA(tempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = rename(tempFileName.c_str(), fileName) == 0;
+#endif
+	if (!renamed) {
+		remove(tempFileName.c_str());
+	}
+	return renamed;
+}
+
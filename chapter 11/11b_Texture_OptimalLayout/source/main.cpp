@@ -40,15 +40,33 @@ std::vector<const char *> deviceExtensionNames = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Number of frames rendered in headless mode when not specified
+#define HEADLESS_FRAME_COUNT 1000
+
 int main(int argc, char **argv)
 {
 	VulkanApplication* appObj = VulkanApplication::GetInstance();
+
+	// Usage: --headless [frame count], renders offscreen without any window
+	uint32_t frameCount = 0;
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+		appObj->isHeadless = true;
+		frameCount = (argc > 2) ? (uint32_t)atoi(argv[2]) : HEADLESS_FRAME_COUNT;
+
+		// No presentation, surface and swapchain extensions are not needed
+		instanceExtensionNames = { VK_EXT_DEBUG_REPORT_EXTENSION_NAME };
+		deviceExtensionNames.clear();
+	}
+
 	appObj->initialize();
 	appObj->prepare();
 	bool isWindowOpen = true;
-	while (isWindowOpen) {
+	for (uint32_t frame = 0; isWindowOpen; frame++) {
 		appObj->update();
 		isWindowOpen = appObj->render();
+		if (appObj->isHeadless && frame + 1 >= frameCount) {
+			break;
+		}
 	}
 	appObj->deInitialize();
 }